@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <new>
+
+#include "alloc.h"
+
+// plain data, so using them needs no thread-local constructor
+static thread_local long long allocs = 0, bytes = 0, frees = 0;
+
+AllocCount allocCount(){
+	AllocCount c;
+	c.allocs = allocs;
+	c.bytes = bytes;
+	c.frees = frees;
+	return c;
+}
+
+static void *allocate(std::size_t size){
+	void *p = malloc(size ? size : 1);
+	if(!p)
+		throw std::bad_alloc();
+	allocs++;
+	bytes += size;
+	return p;
+}
+
+static void release(void *p){
+	if(!p)
+		return;
+	frees++;
+	free(p);
+}
+
+void *operator new(std::size_t size){
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size){
+	return allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	void *p = malloc(size ? size : 1);
+	if(p){
+		allocs++;
+		bytes += size;
+	}
+	return p;
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &t) noexcept {
+	return operator new(size, t);
+}
+
+void operator delete(void *p) noexcept {
+	release(p);
+}
+
+void operator delete[](void *p) noexcept {
+	release(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	release(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+	release(p);
+}
@@ -0,0 +1,27 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+/* Heap allocation counts. Linking alloc.cpp replaces the global
+   operator new and delete with versions that count every allocation
+   made through them on the calling thread. Allocations made directly
+   with malloc(), as C libraries and drivers do, are not seen. */
+
+struct AllocCount {
+	long long allocs;
+	long long bytes;
+	long long frees;
+};
+
+/* Totals of the calling thread since it started */
+AllocCount allocCount();
+
+/* What the calling thread allocated since an earlier allocCount() */
+inline AllocCount allocSince(const AllocCount &then){
+	AllocCount now = allocCount();
+	now.allocs -= then.allocs;
+	now.bytes -= then.bytes;
+	now.frees -= then.frees;
+	return now;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <SOIL/SOIL.h>
+
+#include "meshes.h"
+#include "pack.h"
+
+using namespace std;
+
+/* Offline asset baker: decodes the textures and builds their mipmaps,
+   generates every model in meshes.h and copies the shader sources, all
+   into one pack the game maps at startup.
+
+   usage: bake OUT FILE...   (.png files are textures, others shaders) */
+
+/* Halve an RGB image with a box filter; odd edges repeat their last texel */
+static void halve(const vector<unsigned char> &src, int w, int h, vector<unsigned char> &dst, int &dw, int &dh){
+	int x, y, c;
+	dw = w > 1 ? w/2 : 1;
+	dh = h > 1 ? h/2 : 1;
+	dst.resize(3*dw*dh);
+	for(y=0;y<dh;y++)
+		for(x=0;x<dw;x++){
+			int x0 = 2*x < w ? 2*x : w-1, x1 = 2*x+1 < w ? 2*x+1 : x0;
+			int y0 = 2*y < h ? 2*y : h-1, y1 = 2*y+1 < h ? 2*y+1 : y0;
+			for(c=0;c<3;c++)
+				dst[3*(y*dw+x)+c] = (src[3*(y0*w+x0)+c] + src[3*(y0*w+x1)+c]
+						+ src[3*(y1*w+x0)+c] + src[3*(y1*w+x1)+c] + 2) / 4;
+		}
+}
+
+static bool bakeTexture(PackWriter &pack, const char *path){
+	int w, h, levels = 1;
+	unsigned char *image = SOIL_load_image(path, &w, &h, 0, SOIL_LOAD_RGB);
+	if(!image){
+		fprintf(stderr, "cannot load %s\n", path);
+		return false;
+	}
+	vector<unsigned char> level(image, image + 3*w*h), next;
+	string chain((const char *)image, 3*w*h);
+	SOIL_free_image_data(image);
+	int lw = w, lh = h;
+	while(lw > 1 || lh > 1){
+		halve(level, lw, lh, next, lw, lh);
+		chain.append((const char *)next.data(), next.size());
+		level.swap(next);
+		levels++;
+	}
+	pack.add(path, PACK_TEXTURE, w, h, levels, chain.data(), chain.size());
+	return true;
+}
+
+static bool bakeShader(PackWriter &pack, const char *path){
+	ifstream in(path, ios::in | ios::binary);
+	stringstream text;
+	if(!in.is_open()){
+		fprintf(stderr, "cannot read %s\n", path);
+		return false;
+	}
+	text << in.rdbuf();
+	string s = text.str();
+	pack.add(path, PACK_SHADER, 0, 0, 0, s.data(), s.size());
+	return true;
+}
+
+int main(int argc, char **argv){
+	PackWriter pack;
+	MeshData m;
+	int i;
+	if(argc < 2){
+		fprintf(stderr, "usage: %s OUT FILE...\n", argv[0]);
+		return 2;
+	}
+	for(i=2;i<argc;i++){
+		const char *dot = strrchr(argv[i], '.');
+		bool ok = dot && !strcmp(dot, ".png") ? bakeTexture(pack, argv[i]) : bakeShader(pack, argv[i]);
+		if(!ok)
+			return 1;
+	}
+	for(i=0;i<MODEL_COUNT;i++){
+		buildModel(i, m);
+		pack.add(modelName(i), PACK_MESH, m.mode, m.count, 0, m.storage.data(), m.storage.size()*sizeof(float));
+	}
+	return pack.write(argv[1]) ? 0 : 1;
+}
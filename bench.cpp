@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+
+#include "bench.h"
+
+using namespace std;
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const vector<double> &sorted, double p){
+	long rank = (long)ceil(p*sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void summarizeFrames(vector<double> &ms, BenchResult &r){
+	double total = 0;
+	size_t i;
+	r.frames = ms.size();
+	r.meanMs = r.p50Ms = r.p99Ms = r.maxMs = 0;
+	if(ms.empty())
+		return;
+	sort(ms.begin(), ms.end());
+	for(i=0;i<ms.size();i++)
+		total += ms[i];
+	r.meanMs = total/ms.size();
+	r.p50Ms = percentile(ms, 0.50);
+	r.p99Ms = percentile(ms, 0.99);
+	r.maxMs = ms.back();
+}
+
+void printBench(FILE *fp, const vector<BenchResult> &results){
+	size_t i;
+	int p, k;
+	fprintf(fp, "%-20s %9s %8s %8s %8s %8s %12s\n", "scenario", "entities", "mean ms", "p50", "p99", "max", "ticks/s");
+	for(i=0;i<results.size();i++){
+		const BenchResult &r = results[i];
+		fprintf(fp, "%-20s %9ld %8.3f %8.3f %8.3f %8.3f %12.0f\n", r.name.c_str(), r.entities, r.meanMs, r.p50Ms, r.p99Ms, r.maxMs, r.ticksPerSec);
+	}
+	for(i=0;i<results.size();i++){
+		const BenchResult &r = results[i];
+		if(r.frameAllocs)
+			fprintf(fp, "%-20s allocations: %lld in the tick, %lld drawing, %lld in all (%lld bytes) over %ld frames\n",
+					r.name.c_str(), r.simAllocs, r.drawAllocs, r.frameAllocs, r.allocBytes, r.allocatingFrames);
+	}
+	for(i=0;i<results.size();i++){
+		const BenchResult &r = results[i];
+		if(!r.counted)
+			continue;
+		for(p=PHASE_SIM;p<=PHASE_DRAW;p++){
+			fprintf(fp, "%-20s %-4s per frame:", r.name.c_str(), perfPhaseNames[p]);
+			for(k=0;k<PERF_COUNTERS;k++)
+				if(r.perFrame[p][k] >= 0)
+					fprintf(fp, " %s %.0f", perfCounterNames[k], r.perFrame[p][k]);
+			fprintf(fp, "\n");
+		}
+	}
+}
+
+/* A phase's counters as a JSON object; missing counters are null */
+static void writeCounters(FILE *fp, const double *values){
+	int k;
+	fprintf(fp, "{");
+	for(k=0;k<PERF_COUNTERS;k++)
+		if(values[k] >= 0)
+			fprintf(fp, "%s\"%s\":%.1f", k ? "," : "", perfCounterNames[k], values[k]);
+		else
+			fprintf(fp, "%s\"%s\":null", k ? "," : "", perfCounterNames[k]);
+	fprintf(fp, "}");
+}
+
+bool writeBenchJson(const char *path, const vector<BenchResult> &results, const double *load){
+	size_t i;
+	int p;
+	FILE *fp = fopen(path, "w");
+	if(!fp){
+		fprintf(stderr, "Cannot write %s\n", path);
+		return false;
+	}
+	fprintf(fp, "{");
+	if(load){
+		fprintf(fp, "\"load\":");
+		writeCounters(fp, load);
+		fprintf(fp, ",\n");
+	}
+	fprintf(fp, "\"scenarios\":[\n");
+	for(i=0;i<results.size();i++){
+		const BenchResult &r = results[i];
+		fprintf(fp, "%s{\"name\":\"%s\",\"frames\":%ld,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f,\"ticks_per_sec\":%.1f,\"restarts\":%ld",
+				i ? ",\n" : "", r.name.c_str(), r.frames, r.meanMs, r.p50Ms, r.p99Ms, r.maxMs, r.ticksPerSec, r.restarts);
+		fprintf(fp, ",\"level\":{\"seed\":%u,\"width\":%d,\"depth\":%d,\"coins\":%d,\"obstacles\":%d,\"moving_percent\":%d,\"cans\":%d,\"entities\":%ld}",
+				r.seed, r.width, r.depth, r.coins, r.obstacles, r.movingPercent, r.cans, r.entities);
+		fprintf(fp, ",\"allocs\":{\"sim\":%lld,\"draw\":%lld,\"frame\":%lld,\"bytes\":%lld,\"frames\":%ld}",
+				r.simAllocs, r.drawAllocs, r.frameAllocs, r.allocBytes, r.allocatingFrames);
+		if(r.counted)
+			for(p=PHASE_SIM;p<=PHASE_DRAW;p++){
+				fprintf(fp, ",\"%s_per_frame\":", perfPhaseNames[p]);
+				writeCounters(fp, r.perFrame[p]);
+			}
+		fprintf(fp, "}");
+	}
+	fprintf(fp, "\n]}\n");
+	return fclose(fp) == 0;
+}
@@ -0,0 +1,33 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "perfcount.h"
+
+/* Timing summary of one benchmark scenario */
+struct BenchResult {
+	std::string name;
+	unsigned int seed;
+	int width, depth, coins, obstacles, movingPercent, cans;	// the level
+	long entities;
+	long frames;
+	double meanMs, p50Ms, p99Ms, maxMs;	// whole frames, sim tick included
+	double ticksPerSec;	// sim ticks alone
+	long long simAllocs, drawAllocs, frameAllocs, allocBytes;	// heap allocations over the timed frames
+	long allocatingFrames;	// frames that allocated
+	long restarts;	// frames that started the level over, left out of the rest
+	bool counted;	// with --perf: the counters below are filled in
+	double perFrame[PERF_PHASES][PERF_COUNTERS];	// per frame and phase, -1 if missing
+};
+
+/* Fill in the frame-time fields from one sample per frame; sorts ms */
+void summarizeFrames(std::vector<double> &ms, BenchResult &r);
+void printBench(FILE *fp, const std::vector<BenchResult> &results);
+/* Results as JSON, one object per scenario, for tools to compare; load
+   is the loading phase's counters (-1 where missing), or NULL */
+bool writeBenchJson(const char *path, const std::vector<BenchResult> &results, const double *load);
+
+#endif
@@ -0,0 +1,70 @@
+#include "drawstats.h"
+
+DrawStats drawStats;
+
+static const char *statNames[DRAW_STATS] = { "draws", "vertices", "programs", "textures", "uniforms", "bytes", "allocs", "alloc_bytes" };
+
+DrawStats::DrawStats(){
+	int i;
+	for(i=0;i<DRAW_STATS;i++)
+		now[i] = done[i] = 0;
+	for(i=0;i<STATS_HISTORY;i++)
+		ms[i] = 0;
+	count = 0;
+	csv = NULL;
+}
+
+DrawStats::~DrawStats(){
+	closeCsv();
+}
+
+void DrawStats::frameDone(double frameMs){
+	int i;
+	ms[count % STATS_HISTORY] = frameMs;
+	count++;
+	for(i=0;i<DRAW_STATS;i++){
+		done[i] = now[i];
+		now[i] = 0;
+	}
+	if(csv){
+		fprintf(csv, "%ld,%.3f", count, frameMs);
+		for(i=0;i<DRAW_STATS;i++)
+			fprintf(csv, ",%lld", done[i]);
+		fprintf(csv, "\n");
+	}
+}
+
+bool DrawStats::openCsv(const char *path){
+	int i;
+	closeCsv();
+	csv = fopen(path, "w");
+	if(!csv){
+		fprintf(stderr, "Cannot write %s\n", path);
+		return false;
+	}
+	fprintf(csv, "frame,ms");
+	for(i=0;i<DRAW_STATS;i++)
+		fprintf(csv, ",%s", statNames[i]);
+	fprintf(csv, "\n");
+	return true;
+}
+
+void DrawStats::closeCsv(){
+	if(csv)
+		fclose(csv);
+	csv = NULL;
+}
+
+double DrawStats::frameMs(int ago) const {
+	if(ago >= count || ago >= STATS_HISTORY)
+		return 0;
+	return ms[(count - 1 - ago) % STATS_HISTORY];
+}
+
+double DrawStats::fps() const {
+	double total = 0;
+	int i, n = count < STATS_HISTORY ? count : STATS_HISTORY;
+	for(i=0;i<n;i++)
+		total += ms[i];
+	return total > 0 ? n*1000.0/total : 0;
+}
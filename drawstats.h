@@ -0,0 +1,43 @@
+#ifndef DRAWSTATS_H
+#define DRAWSTATS_H
+
+#include <cstdio>
+
+/* Per-frame counts of the GL work the renderer asks for: draw calls,
+   vertices, program switches, texture binds, uniform uploads and the
+   bytes sent to the GPU, plus the render thread's heap allocations.
+   The counting wrappers around those calls add to the frame in
+   progress; frameDone() closes it, keeps the last STATS_HISTORY frames
+   for the overlay and writes a CSV row when a file is open. */
+
+enum DrawStat { STAT_DRAWS, STAT_VERTICES, STAT_PROGRAMS, STAT_TEXTURES, STAT_UNIFORMS, STAT_BYTES, STAT_ALLOCS, STAT_ALLOC_BYTES, DRAW_STATS };
+
+#define STATS_HISTORY 120	// frames kept for the frame-time graph
+
+class DrawStats{
+	public:
+		DrawStats();
+		~DrawStats();
+		void add(int stat, long long n = 1) { now[stat] += n; }
+		/* ms is the frame's time, start to start */
+		void frameDone(double ms);
+		bool openCsv(const char *path);
+		void closeCsv();
+		/* The counters of the last finished frame */
+		long long last(int stat) const { return done[stat]; }
+		/* Frame time ago frames back, 0 for the last one */
+		double frameMs(int ago) const;
+		/* Frames per second over the history */
+		double fps() const;
+		long frames() const { return count; }
+
+	private:
+		long long now[DRAW_STATS], done[DRAW_STATS];
+		double ms[STATS_HISTORY];
+		long count;
+		FILE *csv;
+};
+
+extern DrawStats drawStats;
+
+#endif
@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+#include "farm.h"
+#include "solver.h"
+
+using namespace std;
+
+#define FARM_BATCH 4096	// seeds solved before their rows are printed
+
+struct FarmRow {
+	bool winnable;
+	int coins;
+	int total;
+	int score;
+	long ticks;
+	long expanded;
+};
+
+/* Per worker; the world and solver keep their buffers from seed to seed */
+struct FarmWorker {
+	World world;
+	Solver solver;
+	SolveResult result;
+};
+
+struct Farm {
+	ReplayHeader level;
+	unsigned int first;
+	vector<FarmWorker *> workers;
+	vector<FarmRow> rows;
+};
+
+static void validateRange(void *ctx, long begin, long end, int worker){
+	Farm &farm = *(Farm *)ctx;
+	FarmWorker &w = *farm.workers[worker];
+	long i;
+	for(i=begin;i<end;i++){
+		FarmRow &row = farm.rows[i];
+		w.world.generate(farm.level.width, farm.level.depth, farm.level.coins, farm.level.obstacles, farm.first + (unsigned int)i, farm.level.movingPercent, farm.level.cans);
+		w.solver.solve(w.world, w.result);
+		row.winnable = w.result.winnable;
+		row.coins = w.result.coins;
+		row.total = w.world.totalCoins;
+		row.score = w.result.score;
+		row.ticks = w.result.winnable ? w.result.ticks : -1;
+		row.expanded = w.result.expanded;
+	}
+}
+
+long validateSeeds(const ReplayHeader &level, unsigned int first, unsigned int last, JobSystem &jobs){
+	Farm farm;
+	long count, done, batch, i, lost = 0, coins = 0, total = 0, expanded = 0;
+	int w;
+
+	count = (long)last - first + 1;
+	farm.level = level;
+	farm.rows.resize(count < FARM_BATCH ? count : FARM_BATCH);
+	for(w=0;w<jobs.size();w++)
+		farm.workers.push_back(new FarmWorker);
+
+	printf("# seed win coins score ticks nodes\n");
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	// a batch at a time, so any range runs in the same memory
+	for(done=0;done<count;done+=batch){
+		batch = count - done < FARM_BATCH ? count - done : FARM_BATCH;
+		farm.first = first + (unsigned int)done;
+		jobs.parallelFor(0, batch, 16, validateRange, &farm);
+		for(i=0;i<batch;i++){
+			const FarmRow &r = farm.rows[i];
+			printf("%u %d %d/%d %d %ld %ld\n", farm.first + (unsigned int)i, r.winnable, r.coins, r.total, r.score, r.ticks, r.expanded);
+			lost += !r.winnable;
+			coins += r.coins;
+			total += r.total;
+			expanded += r.expanded;
+		}
+	}
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	fprintf(stderr, "%ld levels %dx%d on %d threads in %.3f s (%.0f levels/s): %ld winnable, %ld/%ld coins reachable, %.0f nodes per level\n",
+			count, level.width, level.depth, jobs.size(), secs, secs > 0 ? count/secs : 0.0, count - lost, coins, total, (double)expanded/count);
+
+	for(w=0;w<jobs.size();w++)
+		delete farm.workers[w];
+	return lost;
+}
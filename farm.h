@@ -0,0 +1,14 @@
+#ifndef FARM_H
+#define FARM_H
+
+#include "replay.h"
+#include "jobs.h"
+
+/* Batch level validation. Generates the level for every seed in
+   [first, last] with the other parameters of level, solves them in
+   parallel on jobs and prints one table row per seed, in seed order, a
+   batch of seeds at a time. A summary goes to stderr. Returns the number of levels that cannot be
+   won. */
+long validateSeeds(const ReplayHeader &level, unsigned int first, unsigned int last, JobSystem &jobs);
+
+#endif
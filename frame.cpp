@@ -0,0 +1,64 @@
+#include "frame.h"
+
+using namespace std;
+
+#define FRAME_FRESH 4
+
+Frame::Frame(){
+	tick = 0;
+	status = STATUS_PLAYING;
+	score = lives = hitno = 0;
+	levitate = false;
+	levitateTicks = 0;
+	view = 0;
+	eye[0] = eye[1] = eye[2] = 0;
+	target[0] = target[1] = target[2] = 0;
+	player[0] = player[1] = player[2] = 0;
+	lastInput = 0;
+	count = 0;
+}
+
+void Frame::capture(World &world){
+	int i, n = world.count;
+	tick = world.tick;
+	status = world.status;
+	score = world.pl.score;
+	lives = world.pl.lives;
+	hitno = world.pl.hitno;
+	levitate = world.pl.levitate;
+	levitateTicks = world.tick - world.pl.levitateStart;
+	view = world.ctl.view;
+	for(i=0;i<3;i++){
+		eye[i] = world.ctl.eye[i];
+		target[i] = world.ctl.target[i];
+	}
+	player[0] = world.transform.x[world.player];
+	player[1] = world.transform.y[world.player];
+	player[2] = world.transform.z[world.player];
+
+	count = n;
+	x.assign(world.transform.x, world.transform.x + n);
+	y.assign(world.transform.y, world.transform.y + n);
+	z.assign(world.transform.z, world.transform.z + n);
+	angle.assign(world.transform.angle, world.transform.angle + n);
+	mesh.resize(n);
+	for(i=0;i<n;i++)
+		mesh[i] = (world.mask[i] & COMP_RENDERABLE) && world.renderable.visible[i] ? world.renderable.mesh[i] : MESH_NONE;
+}
+
+FrameBuffer::FrameBuffer(){
+	backIndex = 0;
+	middle.store(1);
+	frontIndex = 2;
+}
+
+/* Swap the filled back frame with the spare one */
+void FrameBuffer::publish(){
+	backIndex = middle.exchange(backIndex | FRAME_FRESH, memory_order_acq_rel) & 3;
+}
+
+const Frame &FrameBuffer::latest(){
+	if(middle.load(memory_order_acquire) & FRAME_FRESH)
+		frontIndex = middle.exchange(frontIndex, memory_order_acq_rel) & 3;
+	return frames[frontIndex];
+}
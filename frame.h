@@ -0,0 +1,52 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <atomic>
+#include <vector>
+
+#include "world.h"
+
+/* What the renderer needs from one simulation tick, copied out of the
+   world so the simulation can run on while it is drawn */
+struct Frame {
+	long tick;
+	int status;
+	int score;
+	int lives;
+	int hitno;
+	bool levitate;
+	long levitateTicks;	// ticks since the can was taken
+	int view;
+	float eye[3];
+	float target[3];
+	float player[3];
+	long lastInput;	// last live input event its tick consumed, as LatencyTracker numbers them
+	int count;
+	std::vector<float> x, y, z, angle;
+	std::vector<int> mesh;	// MESH_NONE for entities that are not drawn
+
+	Frame();
+	void capture(World &world);
+};
+
+/* Triple buffer handing frames from the simulation thread to the render
+   thread without locks. The writer fills back() and publishes it; the
+   reader always gets the newest published frame, and neither side ever
+   waits for the other. */
+class FrameBuffer{
+	public:
+		FrameBuffer();
+		/* Writer side */
+		Frame &back(){ return frames[backIndex]; }
+		void publish();
+		/* Reader side; the frame stays valid until the next call */
+		const Frame &latest();
+
+	private:
+		Frame frames[3];
+		int backIndex;	// owned by the writer
+		int frontIndex;	// owned by the reader
+		std::atomic<int> middle;	// index of the spare frame, FRAME_FRESH once published
+};
+
+#endif
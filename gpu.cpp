@@ -0,0 +1,94 @@
+#include "gpu.h"
+
+GpuUsage gpuUsage;
+
+static bool contextLost = false;
+static const char *kindNames[GPU_KINDS] = { "vertex arrays", "buffers", "textures", "programs", "queries" };
+
+GpuHandle::GpuHandle(){
+	kind = GPU_BUFFER;
+	name = 0;
+	size = 0;
+}
+
+GpuHandle::GpuHandle(int k){
+	kind = k;
+	name = 0;
+	size = 0;
+	switch(kind){
+		case GPU_VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+		case GPU_BUFFER: glGenBuffers(1, &name); break;
+		case GPU_TEXTURE: glGenTextures(1, &name); break;
+		case GPU_PROGRAM: name = glCreateProgram(); break;
+		case GPU_QUERY: glGenQueries(1, &name); break;
+	}
+	if(name)
+		gpuUsage.count[kind]++;
+}
+
+GpuHandle::GpuHandle(int k, GLuint n){
+	kind = k;
+	name = n;
+	size = 0;
+	if(name)
+		gpuUsage.count[kind]++;
+}
+
+GpuHandle::GpuHandle(GpuHandle &&other){
+	kind = other.kind;
+	name = other.name;
+	size = other.size;
+	other.name = 0;
+	other.size = 0;
+}
+
+GpuHandle &GpuHandle::operator=(GpuHandle &&other){
+	if(this != &other){
+		reset();
+		kind = other.kind;
+		name = other.name;
+		size = other.size;
+		other.name = 0;
+		other.size = 0;
+	}
+	return *this;
+}
+
+GpuHandle::~GpuHandle(){
+	reset();
+}
+
+void GpuHandle::setBytes(long long bytes){
+	if(!name)
+		return;
+	gpuUsage.bytes[kind] += bytes - size;
+	size = bytes;
+}
+
+void GpuHandle::reset(){
+	if(!name)
+		return;
+	if(!contextLost)
+		switch(kind){
+			case GPU_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+			case GPU_BUFFER: glDeleteBuffers(1, &name); break;
+			case GPU_TEXTURE: glDeleteTextures(1, &name); break;
+			case GPU_PROGRAM: glDeleteProgram(name); break;
+			case GPU_QUERY: glDeleteQueries(1, &name); break;
+		}
+	gpuUsage.count[kind]--;
+	gpuUsage.bytes[kind] -= size;
+	name = 0;
+	size = 0;
+}
+
+void gpuContextLost(){
+	contextLost = true;
+}
+
+void gpuReport(FILE *fp){
+	int k;
+	for(k=0;k<GPU_KINDS;k++)
+		fprintf(fp, "%s%ld %s (%.1f MB)", k ? ", " : "GPU: ", gpuUsage.count[k], kindNames[k], gpuUsage.bytes[k]/1048576.0);
+	fprintf(fp, "\n");
+}
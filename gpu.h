@@ -0,0 +1,51 @@
+#ifndef GPU_H
+#define GPU_H
+
+#include <cstdio>
+#include <glad/glad.h>
+
+/* Owning handles for GL objects. A handle deletes its object when it is
+   destroyed or given another, and moves but never copies, so every object
+   has exactly one owner. The live objects of each kind and the bytes of
+   storage they were given are counted as they come and go. GL thread
+   only. */
+
+enum GpuKind { GPU_VERTEX_ARRAY, GPU_BUFFER, GPU_TEXTURE, GPU_PROGRAM, GPU_QUERY, GPU_KINDS };
+
+struct GpuUsage {
+	long count[GPU_KINDS];
+	long long bytes[GPU_KINDS];
+};
+
+extern GpuUsage gpuUsage;
+
+class GpuHandle{
+	public:
+		GpuHandle();
+		/* A new object of the kind; programs come from glCreateProgram() */
+		explicit GpuHandle(int kind);
+		/* Take over an object made elsewhere */
+		GpuHandle(int kind, GLuint name);
+		GpuHandle(GpuHandle &&other);
+		GpuHandle &operator=(GpuHandle &&other);
+		GpuHandle(const GpuHandle &) = delete;
+		GpuHandle &operator=(const GpuHandle &) = delete;
+		~GpuHandle();
+
+		GLuint id() const { return name; }
+		/* Storage size for the accounting, e.g. after glBufferData() */
+		void setBytes(long long bytes);
+		void reset();
+
+	private:
+		int kind;
+		GLuint name;
+		long long size;
+};
+
+/* The context is going away and takes its objects with it: handles
+   destroyed from now on only update the counts */
+void gpuContextLost();
+void gpuReport(FILE *fp);
+
+#endif
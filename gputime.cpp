@@ -0,0 +1,96 @@
+#include "gputime.h"
+
+static const char *passNames[GPU_PASSES] = { "bricks", "textured", "characters", "obstacles", "can", "hud" };
+
+GpuTimers::GpuTimers(){
+	int f, p, k;
+	enabled = false;
+	frame = 0;
+	active = -1;
+	dropped = 0;
+	for(p=0;p<GPU_PASSES;p++){
+		for(f=0;f<GPU_TIMER_LAG;f++)
+			issued[f][p] = false;
+		for(k=0;k<GPU_TIMER_WINDOW;k++)
+			samples[p][k] = 0;
+		sum[p] = 0;
+		count[p] = 0;
+	}
+}
+
+bool GpuTimers::init(){
+	int f, p;
+	// core since 3.3, which is also what glad loads them for
+	if(!GLAD_GL_VERSION_3_3 && !GLAD_GL_ARB_timer_query)
+		return false;
+	for(f=0;f<GPU_TIMER_LAG;f++)
+		for(p=0;p<GPU_PASSES;p++)
+			queries[f][p] = GpuHandle(GPU_QUERY);
+	enabled = true;
+	return true;
+}
+
+void GpuTimers::begin(int pass){
+	if(!enabled || active >= 0)
+		return;
+	active = pass;
+	glBeginQuery(GL_TIME_ELAPSED, queries[frame % GPU_TIMER_LAG][pass].id());
+}
+
+void GpuTimers::end(){
+	if(active < 0)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	issued[frame % GPU_TIMER_LAG][active] = true;
+	active = -1;
+}
+
+void GpuTimers::frameDone(){
+	GLuint available;
+	GLuint64 ns;
+	int slot, p;
+	double ms;
+	if(!enabled)
+		return;
+	end();
+	frame++;
+	// the oldest frame's queries are about to be reused
+	slot = frame % GPU_TIMER_LAG;
+	for(p=0;p<GPU_PASSES;p++){
+		if(!issued[slot][p])
+			continue;
+		issued[slot][p] = false;
+		glGetQueryObjectuiv(queries[slot][p].id(), GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available){
+			dropped++;
+			continue;
+		}
+		glGetQueryObjectui64v(queries[slot][p].id(), GL_QUERY_RESULT, &ns);
+		ms = ns/1e6;
+		sum[p] += ms - samples[p][count[p] % GPU_TIMER_WINDOW];
+		samples[p][count[p] % GPU_TIMER_WINDOW] = ms;
+		count[p]++;
+	}
+}
+
+double GpuTimers::average(int pass) const {
+	long n = count[pass] < GPU_TIMER_WINDOW ? count[pass] : GPU_TIMER_WINDOW;
+	return n ? sum[pass]/n : 0;
+}
+
+void GpuTimers::report(FILE *fp) const {
+	double total = 0;
+	int p;
+	if(!enabled){
+		fprintf(fp, "GPU time: no timer queries\n");
+		return;
+	}
+	for(p=0;p<GPU_PASSES;p++){
+		fprintf(fp, "%s%s %.3f", p ? ", " : "GPU ms: ", passNames[p], average(p));
+		total += average(p);
+	}
+	fprintf(fp, ", total %.3f", total);
+	if(dropped)
+		fprintf(fp, " (%ld late results dropped)", dropped);
+	fprintf(fp, "\n");
+}
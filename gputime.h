@@ -0,0 +1,44 @@
+#ifndef GPUTIME_H
+#define GPUTIME_H
+
+#include <cstdio>
+
+#include "gpu.h"
+
+/* GPU time of each render pass from GL_TIME_ELAPSED queries. A frame's
+   results are read GPU_TIMER_LAG frames later, by which time the GPU
+   has normally finished with them, so reading never waits on it; a
+   result that is still not there is dropped rather than waited for.
+   Passes cannot nest. GL thread only. */
+
+#define GPU_TIMER_LAG 4	// frames of queries in flight
+#define GPU_TIMER_WINDOW 60	// frames in the rolling average
+
+enum GpuPass { PASS_BRICKS, PASS_TEXTURED, PASS_CHARACTERS, PASS_OBSTACLES, PASS_CAN, PASS_HUD, GPU_PASSES };
+
+class GpuTimers{
+	public:
+		GpuTimers();
+		/* Make the queries; false, and every call a no-op, without timer queries */
+		bool init();
+		void begin(int pass);
+		void end();
+		/* After the last pass of a frame */
+		void frameDone();
+		/* Rolling average of a pass in ms */
+		double average(int pass) const;
+		void report(FILE *fp) const;
+
+	private:
+		bool enabled;
+		int frame;
+		int active;	// pass being timed, -1 for none
+		GpuHandle queries[GPU_TIMER_LAG][GPU_PASSES];
+		bool issued[GPU_TIMER_LAG][GPU_PASSES];
+		double samples[GPU_PASSES][GPU_TIMER_WINDOW];
+		double sum[GPU_PASSES];
+		long count[GPU_PASSES];
+		long dropped;
+};
+
+#endif
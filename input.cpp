@@ -0,0 +1,29 @@
+#include "input.h"
+
+using namespace std;
+
+InputQueue::InputQueue(){
+	dropped = 0;
+	head.store(0);
+	tail.store(0);
+}
+
+bool InputQueue::push(const InputEvent &ev){
+	unsigned int t = tail.load(memory_order_relaxed);
+	if(t - head.load(memory_order_acquire) >= INPUT_QUEUE_SIZE){
+		dropped++;
+		return false;
+	}
+	ring[t % INPUT_QUEUE_SIZE] = ev;
+	tail.store(t + 1, memory_order_release);
+	return true;
+}
+
+bool InputQueue::pop(InputEvent &ev){
+	unsigned int h = head.load(memory_order_relaxed);
+	if(h == tail.load(memory_order_acquire))
+		return false;
+	ev = ring[h % INPUT_QUEUE_SIZE];
+	head.store(h + 1, memory_order_release);
+	return true;
+}
@@ -0,0 +1,71 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <atomic>
+
+/* Window callbacks only record what happened; the simulation drains the
+   queue at the start of a tick and applies events in arrival order, so
+   input never lands between two systems of the same tick. */
+
+enum InputType {
+	INPUT_KEY,
+	INPUT_BUTTON,
+	INPUT_SCROLL,
+	INPUT_CURSOR
+};
+
+/* Keys the game reacts to, independent of the windowing library */
+enum InputKey {
+	KEY_OTHER,
+	KEY_UP,
+	KEY_DOWN,
+	KEY_LEFT,
+	KEY_RIGHT,
+	KEY_SPACE,
+	KEY_T,
+	KEY_C,
+	KEY_F,
+	KEY_S,
+	KEY_P
+};
+
+enum InputAction {
+	ACTION_RELEASE,
+	ACTION_PRESS
+};
+
+enum InputButton {
+	BUTTON_LEFT,
+	BUTTON_RIGHT
+};
+
+struct InputEvent {
+	double time;	// seconds, when the callback fired
+	long long stamp;	// ns on the steady clock, for the latency of live input
+	int type;
+	int code;	// InputKey or InputButton
+	int action;
+	float x, y;	// scroll offsets or cursor position
+};
+
+#define INPUT_QUEUE_SIZE 1024
+
+/* Lock-free ring for exactly one producer (the window callbacks) and one
+   consumer (the simulation). Each side only writes its own index. */
+class InputQueue{
+	public:
+		InputQueue();
+		/* Producer side; returns false and drops the event when full */
+		bool push(const InputEvent &ev);
+		/* Consumer side; returns false when empty */
+		bool pop(InputEvent &ev);
+		unsigned int dropped;
+
+	private:
+		InputEvent ring[INPUT_QUEUE_SIZE];
+		std::atomic<unsigned int> head;	// next slot to read
+		char pad[64];	// keep the two indices on separate cache lines
+		std::atomic<unsigned int> tail;	// next slot to write
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "jobs.h"
+#include "profile.h"
+
+using namespace std;
+
+/* Index of the calling thread in its job system; 0 outside the workers */
+static thread_local int workerIndex = 0;
+
+int JobSystem::current(){
+	return workerIndex;
+}
+
+JobSystem::JobSystem(int n){
+	int i;
+	if(n <= 0)
+		n = thread::hardware_concurrency();
+	count = n > 0 ? n : 1;
+	queues = new Queue[count];
+	queued = 0;
+	stopping = false;
+	for(i=1;i<count;i++)
+		workers.push_back(thread(&JobSystem::loop, this, i));
+}
+
+JobSystem::~JobSystem(){
+	size_t i;
+	{
+		lock_guard<mutex> hold(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(i=0;i<workers.size();i++)
+		workers[i].join();
+	delete[] queues;
+}
+
+/* Worker threads sleep until there is something queued */
+void JobSystem::loop(int self){
+	Job job;
+	workerIndex = self;
+	for(;;){
+		if(take(self, job)){
+			run(self, job);
+			continue;
+		}
+		unique_lock<mutex> hold(sleepLock);
+		wake.wait(hold, [this]{ return queued > 0 || stopping; });
+		if(stopping)
+			return;
+	}
+}
+
+void JobSystem::Queue::pushBack(const Job &job){
+	size_t i;
+	if(size == ring.size()){
+		// double, oldest first
+		vector<Job> bigger(ring.size() ? 2*ring.size() : 16);
+		for(i=0;i<size;i++)
+			bigger[i] = at(i);
+		ring.swap(bigger);
+		first = 0;
+	}
+	at(size++) = job;
+}
+
+void JobSystem::push(int self, const Job &job){
+	{
+		lock_guard<mutex> hold(queues[self].lock);
+		queues[self].pushBack(job);
+	}
+	{
+		lock_guard<mutex> hold(sleepLock);
+		queued++;
+	}
+	wake.notify_one();
+}
+
+/* The newest job of the thread's own queue, else the oldest of another */
+bool JobSystem::take(int self, Job &job){
+	int i, victim;
+	if(queued == 0)
+		return false;
+	for(i=0;i<count;i++){
+		victim = (self + i) % count;
+		Queue &q = queues[victim];
+		lock_guard<mutex> hold(q.lock);
+		if(q.size == 0)
+			continue;
+		if(victim == self)
+			job = q.popBack();
+		else
+			job = q.popFront();
+		queued--;
+		return true;
+	}
+	return false;
+}
+
+/* Split off the back half until the piece is small enough, leaving the
+   halves for whoever is idle, then run what is left */
+void JobSystem::run(int self, Job job){
+	while(job.end - job.begin > job.grain){
+		Job half = job;
+		half.begin = job.begin + (job.end - job.begin)/2;
+		job.end = half.begin;
+		job.pending->fetch_add(1);
+		push(self, half);
+	}
+	{
+		PROFILE("job");
+		job.fn(job.ctx, job.begin, job.end, self);
+	}
+	job.pending->fetch_sub(1);
+}
+
+void JobSystem::parallelFor(long begin, long end, long grain, JobFunc fn, void *ctx){
+	atomic<long> pending(1);
+	int self = current();
+	Job job;
+	if(end <= begin)
+		return;
+	job.fn = fn;
+	job.ctx = ctx;
+	job.begin = begin;
+	job.end = end;
+	job.grain = grain > 0 ? grain : 1;
+	job.pending = &pending;
+	run(self, job);
+	// help with whatever is queued until every piece of this loop is done
+	while(pending > 0){
+		if(take(self, job))
+			run(self, job);
+		else
+			this_thread::yield();
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Work-stealing job system. Every thread has its own deque: it pushes and
+   pops work at the back, and idle threads steal from the front of the
+   others', which is where the largest pieces are. parallelFor() forks by
+   halving its range, queueing one half and carrying on with the other,
+   and joins by running queued work until all of its pieces are done, so
+   it can be called from inside a job too.
+
+   Thread 0 is the thread that created the system; it only works while
+   it waits in parallelFor(). Other threads must not call in. */
+
+typedef void (*JobFunc)(void *ctx, long begin, long end, int worker);
+
+class JobSystem{
+	public:
+		/* threads <= 0 means one per hardware thread, the caller included */
+		JobSystem(int threads);
+		~JobSystem();
+		int size(){ return count; }
+
+		/* Call fn(ctx, b, e, worker) over pieces [b, e) of [begin, end) no
+		   longer than grain, returning once all are done. Calls with the
+		   same worker only overlap when fn itself calls parallelFor(). */
+		void parallelFor(long begin, long end, long grain, JobFunc fn, void *ctx);
+
+	private:
+		struct Job {
+			JobFunc fn;
+			void *ctx;
+			long begin, end, grain;
+			std::atomic<long> *pending;	// pieces of the parallelFor not yet done
+		};
+
+		/* A deque as a ring that only grows, so once it has been as deep as
+		   a frame needs, queueing allocates nothing. Padded so neighbouring
+		   queues do not share a cache line */
+		struct Queue {
+			std::mutex lock;
+			std::vector<Job> ring;
+			size_t first, size;
+			char pad[64];
+
+			Queue(){ first = size = 0; }
+			Job &at(size_t i){ return ring[(first + i) % ring.size()]; }
+			void pushBack(const Job &job);
+			Job popBack(){ size--; return at(size); }
+			Job popFront(){ Job &job = at(0); first = (first + 1) % ring.size(); size--; return job; }
+		};
+
+		int count;
+		Queue *queues;
+		std::vector<std::thread> workers;
+		std::atomic<long> queued;	// jobs in all queues
+		std::atomic<bool> stopping;
+		std::mutex sleepLock;
+		std::condition_variable wake;
+
+		void loop(int self);
+		void push(int self, const Job &job);
+		bool take(int self, Job &job);
+		void run(int self, Job job);
+		static int current();
+};
+
+#endif
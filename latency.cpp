@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "latency.h"
+#include "profile.h"
+
+using namespace std;
+
+LatencyTracker latency;
+
+static const char *stageNames[LATENCY_STAGES] = { "queue", "tick", "pickup", "submit", "swap", "gpu", "total" };
+static const char *stageNotes[LATENCY_STAGES] = {
+	"callback to sim tick", "tick to frame published", "published to drawn", "drawing",
+	"swap call", "swap to GPU done", "callback to GPU done"
+};
+
+LatencyTracker::LatencyTracker(){
+	on = false;
+	consumedCount = publishedCount = 0;
+	drawn = 0;
+	current.first = 1;
+	current.last = 0;
+	oldest = inFlight = 0;
+	kept = dropped = 0;
+}
+
+void LatencyTracker::enable(){
+	samples.resize((size_t)LATENCY_SAMPLES*LATENCY_STAGES);
+	on = true;
+}
+
+void LatencyTracker::consumed(long long input, long long now){
+	if(!on)
+		return;
+	consumedCount++;
+	LatencyEvent &e = ring[consumedCount % LATENCY_RING];
+	e.input = input;
+	e.consumed = now;
+}
+
+long LatencyTracker::published(long long now){
+	long k;
+	if(!on)
+		return 0;
+	for(k=publishedCount+1;k<=consumedCount;k++)
+		ring[k % LATENCY_RING].published = now;
+	publishedCount = consumedCount;
+	return consumedCount;
+}
+
+void LatencyTracker::frameStart(long lastInput){
+	long k;
+	if(!on)
+		return;
+	current.pickup = profileNow();
+	current.first = drawn + 1;
+	current.last = lastInput;
+	if(lastInput <= drawn)
+		return;	// nothing new since the last frame drawn
+	// copied out now: the sim thread reuses its slots LATENCY_RING events on
+	for(k=current.first;k<=lastInput;k++)
+		copied[k % LATENCY_RING] = ring[k % LATENCY_RING];
+	drawn = lastInput;
+}
+
+void LatencyTracker::submitted(){
+	if(on)
+		current.submit = profileNow();
+}
+
+void LatencyTracker::swapped(){
+	if(!on)
+		return;
+	current.swap = profileNow();
+	if(current.first > current.last)
+		return;
+	if(inFlight == LATENCY_FENCES){
+		// the GPU is that far behind: give up on the oldest frame
+		Batch &b = pending[oldest];
+		glDeleteSync(b.fence);
+		dropped += b.last - b.first + 1;
+		oldest = (oldest + 1) % LATENCY_FENCES;
+		inFlight--;
+	}
+	current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();	// or the fence may never reach the GPU
+	pending[(oldest + inFlight) % LATENCY_FENCES] = current;
+	inFlight++;
+}
+
+void LatencyTracker::poll(){
+	GLenum status;
+	if(!on)
+		return;
+	// fences signal in the order they were put in
+	while(inFlight){
+		Batch &b = pending[oldest];
+		status = glClientWaitSync(b.fence, 0, 0);
+		if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		finish(b, profileNow());
+		glDeleteSync(b.fence);
+		oldest = (oldest + 1) % LATENCY_FENCES;
+		inFlight--;
+	}
+}
+
+void LatencyTracker::finish(const Batch &b, long long done){
+	long k;
+	float *s;
+	for(k=b.first;k<=b.last;k++){
+		if(k <= drawn - LATENCY_RING){
+			dropped++;	// copied over by a later frame
+			continue;
+		}
+		const LatencyEvent &e = copied[k % LATENCY_RING];
+		s = &samples[(size_t)(kept % LATENCY_SAMPLES)*LATENCY_STAGES];
+		s[LAT_QUEUE] = (e.consumed - e.input)/1e6;
+		s[LAT_TICK] = (e.published - e.consumed)/1e6;
+		s[LAT_PICKUP] = (b.pickup - e.published)/1e6;
+		s[LAT_SUBMIT] = (b.submit - b.pickup)/1e6;
+		s[LAT_SWAP] = (b.swap - b.submit)/1e6;
+		s[LAT_GPU] = (done - b.swap)/1e6;
+		s[LAT_TOTAL] = (done - e.input)/1e6;
+		kept++;
+	}
+}
+
+void LatencyTracker::report(FILE *fp) const {
+	long n = kept < LATENCY_SAMPLES ? kept : LATENCY_SAMPLES, i;
+	vector<float> v(n);
+	double mean;
+	int stage;
+	if(!on)
+		return;
+	if(!n){
+		fprintf(fp, "latency: no input made it to the screen\n");
+		return;
+	}
+	fprintf(fp, "latency of the last %ld input events (%ld dropped), ms:\n", n, dropped);
+	fprintf(fp, "  %-7s %-24s %8s %8s %8s %8s %8s\n", "stage", "", "mean", "p50", "p95", "p99", "max");
+	for(stage=0;stage<LATENCY_STAGES;stage++){
+		mean = 0;
+		for(i=0;i<n;i++){
+			v[i] = samples[(size_t)i*LATENCY_STAGES + stage];
+			mean += v[i];
+		}
+		sort(v.begin(), v.end());
+		fprintf(fp, "  %-7s %-24s %8.2f %8.2f %8.2f %8.2f %8.2f\n", stageNames[stage], stageNotes[stage], mean/n,
+				v[(n-1)*50/100], v[(n-1)*95/100], v[(n-1)*99/100], v[n-1]);
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include "gpu.h"
+
+/* Input-to-photon latency of live input, stage by stage. An event is
+   stamped when its window callback fires, when a sim tick consumes it
+   and when that tick's frame is published; the render thread then
+   stamps the first frame that includes it as it is picked up, submitted
+   and swapped, and once a fence put in after the swap has signaled, the
+   GPU has finished it. Scanout after that is up to the display and is
+   not seen.
+
+   The sim thread numbers the events it consumes and every frame carries
+   the number of the last one, so an event is charged to the first frame
+   drawn with it however many frames the triple buffer skipped. Fences
+   are polled without waiting, once at the top of the frame loop and
+   once after the swap, so the GPU stage reads late by up to the time
+   between polls; fences still out at the end go with the context. Both
+   threads share one instance: consumed() and published() belong to the
+   sim thread, the rest to the GL thread. */
+
+enum LatencyStage { LAT_QUEUE, LAT_TICK, LAT_PICKUP, LAT_SUBMIT, LAT_SWAP, LAT_GPU, LAT_TOTAL, LATENCY_STAGES };
+
+#define LATENCY_RING 1024	// events between the two threads
+#define LATENCY_FENCES 8	// frames in flight on the GPU
+#define LATENCY_SAMPLES 16384	// events kept for the distributions
+
+struct LatencyEvent {
+	long long input, consumed, published;	// ns on the steady clock
+};
+
+class LatencyTracker{
+	public:
+		LatencyTracker();
+		/* Before the sim thread starts; nothing is tracked otherwise */
+		void enable();
+		bool enabled() const { return on; }
+		/* Sim thread: a live event stamped input was applied at now */
+		void consumed(long long input, long long now);
+		/* Sim thread: the tick's frame is about to be published; returns
+		   the number of the last event consumed, for Frame::lastInput */
+		long published(long long now);
+		/* GL thread, in this order for every drawn frame */
+		void frameStart(long lastInput);
+		void submitted();
+		void swapped();
+		/* Finish the frames whose fences have signaled */
+		void poll();
+		void report(FILE *fp) const;
+
+	private:
+		struct Batch {
+			long first, last;	// events, inclusive
+			long long pickup, submit, swap;
+			GLsync fence;
+		};
+		bool on;
+		// sim thread
+		LatencyEvent ring[LATENCY_RING];
+		long consumedCount, publishedCount;
+		// GL thread
+		LatencyEvent copied[LATENCY_RING];
+		long drawn;
+		Batch current;
+		Batch pending[LATENCY_FENCES];
+		int oldest, inFlight;
+		std::vector<float> samples;	// LATENCY_STAGES per event, in ms
+		long kept, dropped;
+		void finish(const Batch &b, long long done);
+};
+
+extern LatencyTracker latency;
+
+#endif
@@ -4,6 +4,13 @@
 #include <vector>
 #include <sstream>
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -14,15 +21,36 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <SOIL/SOIL.h>
 
+#include "world.h"
+#include "input.h"
+#include "replay.h"
+#include "solver.h"
+#include "farm.h"
+#include "frame.h"
+#include "jobs.h"
+#include "meshes.h"
+#include "pack.h"
+#include "gpu.h"
+#include "profile.h"
+#include "gputime.h"
+#include "drawstats.h"
+#include "bench.h"
+#include "perfcount.h"
+#include "alloc.h"
+#include "stress.h"
+#include "startup.h"
+#include "latency.h"
+
 
 using namespace std;
 
+/* Owns its vertex array and buffers; moves, never copies */
 struct VAO {
-	GLuint VertexArrayID;
-	GLuint VertexBuffer;
-	GLuint ColorBuffer;
-	GLuint TextureBuffer;
-	GLuint TextureID;
+	GpuHandle VertexArray;
+	GpuHandle VertexBuffer;
+	GpuHandle ColorBuffer;
+	GpuHandle TextureBuffer;
+	GLuint TextureID;	// not owned: faces share textures
 
 	GLenum PrimitiveMode;
 	GLenum FillMode;
@@ -39,40 +67,182 @@ struct GLMatrices {
 } Matrices;
 
 GLuint programID, textureProgramID;
+GpuHandle program, textureProgram;	// own the two ids above
+vector<GpuHandle> textures;	// every texture; VAOs refer to them by id
+
+World world;
+InputQueue inputs;
+Recorder recorder;
+ReplayReader replay;
+Bot bot;
+bool useBot = false;
+
+/* The simulation runs on its own thread and hands each tick's state to
+   the render thread through frames */
+FrameBuffer frames;
+JobSystem *jobs;	// shared by loading, drawing and --validate
+Pack assets;	// baked textures, models and shaders, when there is a pack
+const char *profilePath = NULL;	// --profile: where F12 and quitting write the trace
+bool gpuTimes = false;	// --gpu-times: time the render passes on the GPU
+GpuTimers gpuTimers;
+const char *statsPath = NULL;	// --stats: CSV of every frame's counters
+bool perfCounting = false;	// --perf: hardware counters per phase
+PerfCounters perfMain, perfSim;	// render thread: load and draw; sim thread: ticks
+thread simThread;
+atomic<bool> simRunning(false);
+atomic<bool> simDone(false);	// set once a replay has played out
+
+/* Shader source from the asset pack, else read whole from the file */
+std::string shaderSource(const char * path) {
+	const PackEntry *e = assets.find(path, PACK_SHADER);
+	if(e)
+		return std::string((const char *)assets.data(e), e->size);
+	std::ifstream stream(path, std::ios::in | std::ios::binary);
+	std::stringstream code;
+	if(stream.is_open())
+		code << stream.rdbuf();
+	return code.str();
+}
 
-/* Function to load Shaders - Use it as it is */
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path) {
+/* Compiled programs are cached here, one file per pair of sources and driver */
+#define SHADER_CACHE_DIR "shadercache"
+#define SHADER_CACHE_MAGIC "MZSB"
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+/* FNV-1a, 64 bit */
+unsigned long long hashString(unsigned long long h, const std::string &s) {
+	for(size_t i=0;i<s.size();i++)
+		h = (h ^ (unsigned char)s[i]) * 1099511628211ull;
+	return h;
+}
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open())
-	{
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
+/* Vendor, renderer and version: a binary is only good for the driver that made it */
+std::string driverString() {
+	const char *parts[3] = { (const char *)glGetString(GL_VENDOR), (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION) };
+	std::string s;
+	for(int i=0;i<3;i++){
+		s += parts[i] ? parts[i] : "";
+		s += '\n';
 	}
+	return s;
+}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+/* The program cached for this driver, or 0 if there is none or the
+   driver turns it down */
+GLuint loadProgramBinary(const std::string &path, const std::string &driver) {
+	FILE *fp = fopen(path.c_str(), "rb");
+	struct stat st;
+	char magic[4];
+	unsigned int driverLength, length;
+	GLenum format;
+	GLint Result = GL_FALSE;
+	if(!fp)
+		return 0;
+	if(fstat(fileno(fp), &st) < 0){
+		fclose(fp);
+		return 0;
+	}
+	std::string stored;
+	std::vector<char> binary;
+	bool ok = fread(magic, 4, 1, fp) == 1 && !memcmp(magic, SHADER_CACHE_MAGIC, 4)
+		&& fread(&driverLength, sizeof(driverLength), 1, fp) == 1 && driverLength == driver.size();
+	if(ok){
+		stored.resize(driverLength);
+		ok = fread(&stored[0], 1, driverLength, fp) == driverLength && stored == driver
+			&& fread(&format, sizeof(format), 1, fp) == 1 && fread(&length, sizeof(length), 1, fp) == 1;
+	}
+	// a damaged or foreign file must not get to size the buffer
+	ok = ok && length > 0 && (long long)length <= (long long)st.st_size - ftell(fp);
+	if(ok){
+		binary.resize(length);
+		ok = fread(&binary[0], 1, length, fp) == length;
+	}
+	fclose(fp);
+	if(!ok)
+		return 0;
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, format, &binary[0], length);
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if(Result != GL_TRUE){
+		glDeleteProgram(ProgramID);
+		return 0;
 	}
+	return ProgramID;
+}
+
+void saveProgramBinary(GLuint ProgramID, const std::string &path, const std::string &driver) {
+	GLint length = 0;
+	GLenum format;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+		return;
+	std::vector<char> binary(length);
+	glGetProgramBinary(ProgramID, length, NULL, &format, &binary[0]);
+	mkdir(SHADER_CACHE_DIR, 0755);
+	// written aside and renamed over the entry, so a crash or a second
+	// instance never leaves a partial file under a valid name
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%ld.tmp", (long)getpid());
+	std::string temp = path + suffix;
+	FILE *fp = fopen(temp.c_str(), "wb");
+	if(!fp)
+		return;
+	unsigned int driverLength = driver.size(), binaryLength = length;
+	bool ok = fwrite(SHADER_CACHE_MAGIC, 4, 1, fp) == 1
+		&& fwrite(&driverLength, sizeof(driverLength), 1, fp) == 1
+		&& fwrite(driver.data(), 1, driverLength, fp) == driverLength
+		&& fwrite(&format, sizeof(format), 1, fp) == 1
+		&& fwrite(&binaryLength, sizeof(binaryLength), 1, fp) == 1
+		&& fwrite(&binary[0], 1, binaryLength, fp) == binaryLength;
+	if(fclose(fp) != 0)
+		ok = false;
+	if(!ok || rename(temp.c_str(), path.c_str()) != 0)
+		remove(temp.c_str());
+}
+
+/* Print a compile or link log when there is something in it */
+void printInfoLog(const char *what, const std::vector<char> &log) {
+	if(log.size() > 1 && log[0])
+		fprintf(stdout, "%s:\n%s\n", what, &log[0]);
+}
+
+/* Function to load Shaders - Use it as it is. Linked programs are kept
+   in SHADER_CACHE_DIR, keyed by their sources and the driver, and reused
+   on later starts when the driver supports program binaries */
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path) {
+	PROFILE("LoadShaders");
+
+	// Read the shader code
+	std::string VertexShaderCode = shaderSource(vertex_file_path);
+	std::string FragmentShaderCode = shaderSource(fragment_file_path);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
+	// Try the cache first
+	GLint binaryFormats = 0;
+	std::string driver, cachePath;
+	if(GLAD_GL_ARB_get_program_binary)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+	if(binaryFormats > 0){
+		driver = driverString();
+		unsigned long long key = 14695981039346656037ull;
+		key = hashString(key, driver);
+		key = hashString(key, VertexShaderCode);
+		key = hashString(key, std::string(1, '\0'));
+		key = hashString(key, FragmentShaderCode);
+		char name[64];
+		sprintf(name, SHADER_CACHE_DIR "/%016llx.bin", key);
+		cachePath = name;
+		GLuint cached = loadProgramBinary(cachePath, driver);
+		if(cached)
+			return cached;
+	}
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
 	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
 	char const * VertexSourcePointer = VertexShaderCode.c_str();
 	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
 	glCompileShader(VertexShaderID);
@@ -80,12 +250,11 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	// Check Vertex Shader
 	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
 	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> VertexShaderErrorMessage(InfoLogLength);
+	std::vector<char> VertexShaderErrorMessage( max(InfoLogLength, int(1)) );
 	glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-	fprintf(stdout, "%s\n", &VertexShaderErrorMessage[0]);
+	printInfoLog(vertex_file_path, VertexShaderErrorMessage);
 
 	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
 	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
 	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
 	glCompileShader(FragmentShaderID);
@@ -93,15 +262,16 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	// Check Fragment Shader
 	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
 	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> FragmentShaderErrorMessage(InfoLogLength);
+	std::vector<char> FragmentShaderErrorMessage( max(InfoLogLength, int(1)) );
 	glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-	fprintf(stdout, "%s\n", &FragmentShaderErrorMessage[0]);
+	printInfoLog(fragment_file_path, FragmentShaderErrorMessage);
 
 	// Link the program
-	fprintf(stdout, "Linking program\n");
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	if(binaryFormats > 0)
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -109,11 +279,15 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	std::vector<char> ProgramErrorMessage( max(InfoLogLength, int(1)) );
 	glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-	fprintf(stdout, "%s\n", &ProgramErrorMessage[0]);
+	printInfoLog("link", ProgramErrorMessage);
 
+	glDetachShader(ProgramID, VertexShaderID);
+	glDetachShader(ProgramID, FragmentShaderID);
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	if(Result == GL_TRUE && !cachePath.empty())
+		saveProgramBinary(ProgramID, cachePath, driver);
 	return ProgramID;
 }
 
@@ -122,31 +296,54 @@ static void error_callback(int error, const char* description)
 	fprintf(stderr, "Error: %s\n", description);
 }
 
+/* Stop the simulation thread; the world is the caller's after this */
+void stopSimulation()
+{
+	simRunning = false;
+	if (simThread.joinable())
+		simThread.join();
+}
+
 void quit(GLFWwindow *window)
 {
+	stopSimulation();
+	latency.report(stderr);
+	recorder.close(world.tick, world.checksum());
+	gpuReport(stderr);
+	if(gpuTimes)
+		gpuTimers.report(stderr);
+	perfMain.report(stderr, "perf");
+	perfSim.report(stderr, "perf");
+	drawStats.closeCsv();
+	if(profilePath)
+		profileDump(profilePath);
+	gpuContextLost(); // destroying the window frees whatever is left
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	exit(EXIT_SUCCESS);
 }
 
 
-/* Generate VAO, VBOs and return VAO handle */
-struct VAO* create3DObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, GLenum fill_mode=GL_FILL)
+/* Generate VAO, VBOs and return VAO handle. The data is the caller's
+   and can be freed as soon as this returns */
+VAO create3DObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, GLenum fill_mode=GL_FILL)
 {
-	struct VAO* vao = new struct VAO;
-	vao->PrimitiveMode = primitive_mode;
-	vao->NumVertices = numVertices;
-	vao->FillMode = fill_mode;
+	VAO vao;
+	vao.PrimitiveMode = primitive_mode;
+	vao.NumVertices = numVertices;
+	vao.FillMode = fill_mode;
+	vao.TextureID = 0;
 
 	// Create Vertex Array Object
 	// Should be done after CreateWindow and before any other GL calls
-	glGenVertexArrays(1, &(vao->VertexArrayID)); // VAO
-	glGenBuffers (1, &(vao->VertexBuffer)); // VBO - vertices
-	glGenBuffers (1, &(vao->ColorBuffer));  // VBO - colors
+	vao.VertexArray = GpuHandle(GPU_VERTEX_ARRAY); // VAO
+	vao.VertexBuffer = GpuHandle(GPU_BUFFER); // VBO - vertices
+	vao.ColorBuffer = GpuHandle(GPU_BUFFER);  // VBO - colors
 
-	glBindVertexArray (vao->VertexArrayID); // Bind the VAO 
-	glBindBuffer (GL_ARRAY_BUFFER, vao->VertexBuffer); // Bind the VBO vertices 
+	glBindVertexArray (vao.VertexArray.id()); // Bind the VAO 
+	glBindBuffer (GL_ARRAY_BUFFER, vao.VertexBuffer.id()); // Bind the VBO vertices 
 	glBufferData (GL_ARRAY_BUFFER, 3*numVertices*sizeof(GLfloat), vertex_buffer_data, GL_STATIC_DRAW); // Copy the vertices into VBO
+	vao.VertexBuffer.setBytes(3*numVertices*sizeof(GLfloat));
 	glVertexAttribPointer(
 			0,                  // attribute 0. Vertices
 			3,                  // size (x,y,z)
@@ -156,8 +353,10 @@ struct VAO* create3DObject (GLenum primitive_mode, int numVertices, const GLfloa
 			(void*)0            // array buffer offset
 			);
 
-	glBindBuffer (GL_ARRAY_BUFFER, vao->ColorBuffer); // Bind the VBO colors 
+	glBindBuffer (GL_ARRAY_BUFFER, vao.ColorBuffer.id()); // Bind the VBO colors 
 	glBufferData (GL_ARRAY_BUFFER, 3*numVertices*sizeof(GLfloat), color_buffer_data, GL_STATIC_DRAW);  // Copy the vertex colors
+	vao.ColorBuffer.setBytes(3*numVertices*sizeof(GLfloat));
+	drawStats.add(STAT_BYTES, 6*numVertices*sizeof(GLfloat));
 	glVertexAttribPointer(
 			1,                  // attribute 1. Color
 			3,                  // size (r,g,b)
@@ -171,35 +370,36 @@ struct VAO* create3DObject (GLenum primitive_mode, int numVertices, const GLfloa
 }
 
 /* Generate VAO, VBOs and return VAO handle - Common Color for all vertices */
-struct VAO* create3DObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat red, const GLfloat green, const GLfloat blue, GLenum fill_mode=GL_FILL)
+VAO create3DObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat red, const GLfloat green, const GLfloat blue, GLenum fill_mode=GL_FILL)
 {
-	GLfloat* color_buffer_data = new GLfloat [3*numVertices];
+	vector<GLfloat> color_buffer_data (3*numVertices);
 	for (int i=0; i<numVertices; i++) {
 		color_buffer_data [3*i] = red;
 		color_buffer_data [3*i + 1] = green;
 		color_buffer_data [3*i + 2] = blue;
 	}
 
-	return create3DObject(primitive_mode, numVertices, vertex_buffer_data, color_buffer_data, fill_mode);
+	return create3DObject(primitive_mode, numVertices, vertex_buffer_data, color_buffer_data.data(), fill_mode);
 }
 
-struct VAO* create3DTexturedObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* texture_buffer_data, GLuint textureID, GLenum fill_mode=GL_FILL)
+VAO create3DTexturedObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* texture_buffer_data, GLuint textureID, GLenum fill_mode=GL_FILL)
 {
-	struct VAO* vao = new struct VAO;
-	vao->PrimitiveMode = primitive_mode;
-	vao->NumVertices = numVertices;
-	vao->FillMode = fill_mode;
-	vao->TextureID = textureID;
+	VAO vao;
+	vao.PrimitiveMode = primitive_mode;
+	vao.NumVertices = numVertices;
+	vao.FillMode = fill_mode;
+	vao.TextureID = textureID;
 
 	// Create Vertex Array Object
 	// Should be done after CreateWindow and before any other GL calls
-	glGenVertexArrays(1, &(vao->VertexArrayID)); // VAO
-	glGenBuffers (1, &(vao->VertexBuffer)); // VBO - vertices
-	glGenBuffers (1, &(vao->TextureBuffer));  // VBO - textures
+	vao.VertexArray = GpuHandle(GPU_VERTEX_ARRAY); // VAO
+	vao.VertexBuffer = GpuHandle(GPU_BUFFER); // VBO - vertices
+	vao.TextureBuffer = GpuHandle(GPU_BUFFER);  // VBO - textures
 
-	glBindVertexArray (vao->VertexArrayID); // Bind the VAO
-	glBindBuffer (GL_ARRAY_BUFFER, vao->VertexBuffer); // Bind the VBO vertices
+	glBindVertexArray (vao.VertexArray.id()); // Bind the VAO
+	glBindBuffer (GL_ARRAY_BUFFER, vao.VertexBuffer.id()); // Bind the VBO vertices
 	glBufferData (GL_ARRAY_BUFFER, 3*numVertices*sizeof(GLfloat), vertex_buffer_data, GL_STATIC_DRAW); // Copy the vertices into VBO
+	vao.VertexBuffer.setBytes(3*numVertices*sizeof(GLfloat));
 	glVertexAttribPointer(
 			0,                  // attribute 0. Vertices
 			3,                  // size (x,y,z)
@@ -209,8 +409,10 @@ struct VAO* create3DTexturedObject (GLenum primitive_mode, int numVertices, cons
 			(void*)0            // array buffer offset
 			);
 
-	glBindBuffer (GL_ARRAY_BUFFER, vao->TextureBuffer); // Bind the VBO textures
+	glBindBuffer (GL_ARRAY_BUFFER, vao.TextureBuffer.id()); // Bind the VBO textures
 	glBufferData (GL_ARRAY_BUFFER, 2*numVertices*sizeof(GLfloat), texture_buffer_data, GL_STATIC_DRAW);  // Copy the vertex colors
+	vao.TextureBuffer.setBytes(2*numVertices*sizeof(GLfloat));
+	drawStats.add(STAT_BYTES, 5*numVertices*sizeof(GLfloat));
 	glVertexAttribPointer(
 			2,                  // attribute 2. Textures
 			2,                  // size (s,t)
@@ -223,64 +425,124 @@ struct VAO* create3DTexturedObject (GLenum primitive_mode, int numVertices, cons
 	return vao;
 }
 
+/* A generated model, uploaded straight from the asset pack when it has
+   it and built here when not */
+VAO createModel (int model)
+{
+	MeshData m;
+	const PackEntry *e = assets.find(modelName(model), PACK_MESH);
+	if (e && e->size == 6*e->params[1]*sizeof(GLfloat)) {
+		m.mode = e->params[0];
+		m.count = e->params[1];
+		m.vertices = (const GLfloat *)assets.data(e);
+		m.colors = m.vertices + 3*m.count;
+	}
+	else
+		buildModel(model, m);
+	return create3DObject(m.mode, m.count, m.vertices, m.colors, GL_FILL);
+}
+
+/* The state changes the renderer makes, counted for the perf overlay */
+void useProgram (GLuint id)
+{
+	drawStats.add(STAT_PROGRAMS);
+	glUseProgram(id);
+}
+
+void bindTexture (GLuint id)
+{
+	drawStats.add(STAT_TEXTURES);
+	glBindTexture(GL_TEXTURE_2D, id);
+}
+
+void uploadMVP (const glm::mat4 &MVP)
+{
+	drawStats.add(STAT_UNIFORMS);
+	drawStats.add(STAT_BYTES, sizeof(MVP));
+	glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+}
+
 /* Render the VBOs handled by VAO */
-void draw3DObject (struct VAO* vao)
+void draw3DObject (const VAO &vao)
 {
+	drawStats.add(STAT_DRAWS);
+	drawStats.add(STAT_VERTICES, vao.NumVertices);
 	// Change the Fill Mode for this object
-	glPolygonMode (GL_FRONT_AND_BACK, vao->FillMode);
+	glPolygonMode (GL_FRONT_AND_BACK, vao.FillMode);
 
 	// Bind the VAO to use
-	glBindVertexArray (vao->VertexArrayID);
+	glBindVertexArray (vao.VertexArray.id());
 
 	// Enable Vertex Attribute 0 - 3d Vertices
 	glEnableVertexAttribArray(0);
 	// Bind the VBO to use
-	glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vao.VertexBuffer.id());
 
 	// Enable Vertex Attribute 1 - Color
 	glEnableVertexAttribArray(1);
 	// Bind the VBO to use
-	glBindBuffer(GL_ARRAY_BUFFER, vao->ColorBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vao.ColorBuffer.id());
 
 	// Draw the geometry !
-	glDrawArrays(vao->PrimitiveMode, 0, vao->NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
+	glDrawArrays(vao.PrimitiveMode, 0, vao.NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
 }
 
 
-void draw3DTexturedObject (struct VAO* vao){
+void draw3DTexturedObject (const VAO &vao){
+	drawStats.add(STAT_DRAWS);
+	drawStats.add(STAT_VERTICES, vao.NumVertices);
 	// Change the Fill Mode for this object
-	glPolygonMode (GL_FRONT_AND_BACK, vao->FillMode);
+	glPolygonMode (GL_FRONT_AND_BACK, vao.FillMode);
 
 	// Bind the VAO to use
-	glBindVertexArray (vao->VertexArrayID);
+	glBindVertexArray (vao.VertexArray.id());
 
 	// Enable Vertex Attribute 0 - 3d Vertices
 	glEnableVertexAttribArray(0);
 	// Bind the VBO to use
-	glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vao.VertexBuffer.id());
 
 	// Bind Textures using texture units
-	glBindTexture(GL_TEXTURE_2D, vao->TextureID);
+	bindTexture(vao.TextureID);
 
 	// Enable Vertex Attribute 2 - Texture
 	glEnableVertexAttribArray(2);
 	// Bind the VBO to use
-	glBindBuffer(GL_ARRAY_BUFFER, vao->TextureBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vao.TextureBuffer.id());
 
 	// Draw the geometry !
-	glDrawArrays(vao->PrimitiveMode, 0, vao->NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
+	glDrawArrays(vao.PrimitiveMode, 0, vao.NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
 
 	// Unbind Textures to be safe
-	glBindTexture(GL_TEXTURE_2D, 0);
+	bindTexture(0);
 }
 
-/* Create an OpenGL Texture from an image */
-GLuint createTexture (const char* filename){
-	GLuint TextureID;
+/* An image file, its decoded pixels and, once uploaded, its texture */
+struct TextureLoad {
+	const char *path;
+	unsigned char *image;
+	int width, height;
+	atomic<bool> decoded;
+	GpuHandle texture;
+};
+
+/* Distinct image files being loaded together */
+struct TextureBatch {
+	TextureLoad *loads;
+	int count;
+};
+
+/* Create an OpenGL Texture from a decoded image, freeing the pixels */
+GpuHandle createTexture (TextureLoad &load){
+	PROFILE("upload texture");
+	GLsizeiptr size = (GLsizeiptr)load.width * load.height * 3;
+	long long bytes = 0;
+	void *staging;
+	int levels = 1, w, h;
 	// Generate Texture Buffer
-	glGenTextures(1, &TextureID);
+	GpuHandle texture(GPU_TEXTURE);
 	// All upcoming GL_TEXTURE_2D operations now have effect on our texture buffer
-	glBindTexture(GL_TEXTURE_2D, TextureID);
+	glBindTexture(GL_TEXTURE_2D, texture.id());
 	// Set our texture parameters
 	// Set texture wrapping to GL_REPEAT
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -288,16 +550,123 @@ GLuint createTexture (const char* filename){
 	// Set texture filtering (interpolation)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	if(!load.image){
+		cerr << "cannot load " << load.path << endl;
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
 
-	// Load image and create OpenGL texture
-	int twidth, theight;
-	unsigned char* image = SOIL_load_image(filename, &twidth, &theight, 0, SOIL_LOAD_RGB);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, twidth, theight, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	// Copy the pixels into a pixel unpack buffer, so the transfer to the
+	// texture is left to the driver instead of stalling here
+	GpuHandle pixels(GPU_BUFFER); // released once the transfer is done
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixels.id());
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	pixels.setBytes(size);
+	drawStats.add(STAT_BYTES, size);
+	staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if(staging){
+		memcpy(staging, load.image, size);
+		if(!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+			staging = NULL;
+	}
+	if(!staging)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // upload straight from the image instead
+
+	// Immutable storage for the whole mipmap chain where the driver has it
+	while((load.width | load.height) >> levels)
+		levels++;
+	if(GLAD_GL_ARB_texture_storage)
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGB8, load.width, load.height);
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, load.width, load.height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // decoded rows are not padded
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, load.width, load.height, GL_RGB, GL_UNSIGNED_BYTE, staging ? NULL : load.image);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	glGenerateMipmap(GL_TEXTURE_2D); // Generate MipMaps to use
-	SOIL_free_image_data(image); // Free the data read from file after creating opengl texture
+	SOIL_free_image_data(load.image); // Free the data read from file after creating opengl texture
+	load.image = NULL;
 	glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture when done, so we won't accidentily mess it up
 
-	return TextureID;
+	for(w=load.width,h=load.height;levels>0;levels--){
+		bytes += 3LL*w*h;
+		w = w > 1 ? w/2 : 1;
+		h = h > 1 ? h/2 : 1;
+	}
+	texture.setBytes(bytes);
+	return texture;
+}
+
+/* A texture whose mipmaps were baked into the asset pack, uploaded from
+   the mapping level by level. An empty handle if the entry's size does
+   not match the chain its dimensions call for, for the caller to load
+   the file instead */
+GpuHandle createPackedTexture (const PackEntry *e)
+{
+	const unsigned char *pixels = (const unsigned char *)assets.data(e);
+	int width = e->params[0], height = e->params[1], levels = e->params[2];
+	int level, w, h;
+	unsigned long long chain = 0;
+	if(width < 1 || height < 1 || width > 65536 || height > 65536 || levels < 1 || levels > 17)
+		return GpuHandle();
+	for(level=0,w=width,h=height;level<levels;level++){
+		chain += 3ULL*w*h;
+		w = w > 1 ? w/2 : 1;
+		h = h > 1 ? h/2 : 1;
+	}
+	if(chain != e->size){
+		fprintf(stderr, "%s in the asset pack does not match its size, loading the file\n", e->name);
+		return GpuHandle();
+	}
+	GpuHandle texture(GPU_TEXTURE);
+	glBindTexture(GL_TEXTURE_2D, texture.id());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if(GLAD_GL_ARB_texture_storage)
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGB8, width, height);
+	for(level=0;level<levels;level++){
+		if(GLAD_GL_ARB_texture_storage)
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		else
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		pixels += 3*width*height;
+		width = width > 1 ? width/2 : 1;
+		height = height > 1 ? height/2 : 1;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.setBytes(e->size);
+	drawStats.add(STAT_BYTES, e->size);
+	return texture;
+}
+
+/* Upload whatever has been decoded so far. GL thread only */
+void uploadDecoded (TextureBatch &batch)
+{
+	int i;
+	for (i=0;i<batch.count;i++)
+		if (!batch.loads[i].texture.id() && batch.loads[i].decoded.load(memory_order_acquire))
+			batch.loads[i].texture = createTexture(batch.loads[i]);
+}
+
+/* Decoding needs no GL, so it runs on the job system. Worker 0 is the GL
+   thread: between decodes it uploads what the others have finished */
+void decodeTextures (void *ctx, long begin, long end, int worker)
+{
+	TextureBatch &batch = *(TextureBatch *)ctx;
+	long i;
+	PROFILE("decode textures");
+	for (i=begin;i<end;i++){
+		TextureLoad &load = batch.loads[i];
+		if (load.decoded.load(memory_order_relaxed))
+			continue; // came from the asset pack
+		load.image = SOIL_load_image(load.path, &load.width, &load.height, 0, SOIL_LOAD_RGB);
+		load.decoded.store(true, memory_order_release);
+	}
+	if (worker == 0)
+		uploadDecoded(batch);
 }
 
 
@@ -330,16 +699,11 @@ glm::vec3 up4 (0, 1, 0);
 // Up - Up vector defines tilt of camera.  Don't change unless you are sure!!
 //glm::vec3 up (0, 1, 0);
 int view=0;
-int choice=0;
-float deltaTime=0;
-bool jump=false;
 bool now=false;
-float eye4x = 8,eye4y = 8, eye4z = 11;
-float target4x = 4,target4y = 8, target4z = 11;
 class Background{
 	public:
 
-		VAO *axis;
+		VAO axis;
 		void createAxes(){
 
 			static const GLfloat vertex_buffer_data [] = {
@@ -369,11 +733,11 @@ class Background{
 		void clean1(){
 
 			glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glUseProgram (programID);
-			glUseProgram(textureProgramID);
+			useProgram(programID);
+			useProgram(textureProgramID);
 		}
 		void draw(){
-			glUseProgram (programID);
+			useProgram(programID);
 			if(view==3)
 				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
 			else if(view==4)
@@ -390,7 +754,7 @@ class Background{
 			glm::mat4 MVP;	// MVP = Projection * View * Model
 			Matrices.model = glm::mat4(1.0f);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			//draw3DObject(axis);
 
 		}
@@ -403,7 +767,7 @@ Background bg;
 class Heart{
 
 	public:
-		VAO *hrt[3];
+		VAO hrt[3];
 		float posx;
 		float posy;
 		float radius;
@@ -433,53 +797,15 @@ class Heart{
 		}
 
 		void createLeft(int index){
-			int numVertices = 190;
-			GLfloat* vertex_buffer_data = new GLfloat [3*numVertices];
-			for (int i=0; i<numVertices; i++) {
-				vertex_buffer_data [3*i] = -0.062 + radius*cos(i*M_PI/180.0f);
-				vertex_buffer_data [3*i + 1] = 0.125 + radius*sin(i*M_PI/180.0f);
-				vertex_buffer_data [3*i + 2] = 0;
-			}
-
-
-			GLfloat* color_buffer_data = new GLfloat [3*numVertices];
-			for (int i=0; i<numVertices; i++) {
-				color_buffer_data [3*i] = 1;
-				color_buffer_data [3*i + 1] = 0;
-				color_buffer_data [3*i + 2] = 0;
-			}
-
-
-			// create3DObject creates and returns a handle to a VAO that can be used later
-			hrt[index] = create3DObject(GL_TRIANGLE_FAN, numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
-
+			hrt[index] = createModel(MODEL_HEART_LEFT);
 		}
 
 		void createRight(int index){
-			int numVertices = 190;
-			GLfloat* vertex_buffer_data = new GLfloat [3*numVertices];
-			for (int i=0; i<numVertices; i++) {
-				vertex_buffer_data [3*i] = 0.062 + radius*cos(i*M_PI/180.0f);
-				vertex_buffer_data [3*i + 1] = 0.125 + radius*sin(i*M_PI/180.0f);
-				vertex_buffer_data [3*i + 2] = 0;
-			}
-
-
-			GLfloat* color_buffer_data = new GLfloat [3*numVertices];
-			for (int i=0; i<numVertices; i++) {
-				color_buffer_data [3*i] = 1;
-				color_buffer_data [3*i + 1] = 0;
-				color_buffer_data [3*i + 2] = 0;
-			}
-
-
-			// create3DObject creates and returns a handle to a VAO that can be used later
-			hrt[index] = create3DObject(GL_TRIANGLE_FAN, numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
-
+			hrt[index] = createModel(MODEL_HEART_RIGHT);
 		}
 
 		void draw(int index){
-			glUseProgram (programID);
+			useProgram(programID);
 			Matrices.view = glm::lookAt(glm::vec3(1,3,4),glm::vec3(1,3,0),up);
 			glm::mat4 VP = Matrices.projection * Matrices.view;
 			glm::mat4 MVP;  // MVP = Projection * View * Model
@@ -491,7 +817,7 @@ class Heart{
 			glm::mat4 scaleLt = glm::scale(glm::vec3(2, 2, 0));
 			Matrices.model *= (translateLt*scaleLt);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(hrt[index]);
 
 
@@ -505,7 +831,7 @@ Heart heart[4];
 class Bar{
 
 	public:
-		VAO *htb;
+		VAO htb;
 		float posx;
 		float posy;
 		float posz;
@@ -565,7 +891,7 @@ class Bar{
 
 		void draw(float posx,float posy,float scalex,float scaley){
 
-			glUseProgram (programID);
+			useProgram(programID);
 			Matrices.view = glm::lookAt(glm::vec3(1,3,4),glm::vec3(1,3,0),up);
 			glm::mat4 VP = Matrices.projection * Matrices.view;
 			glm::mat4 MVP;  // MVP = Projection * View * Model
@@ -577,7 +903,7 @@ class Bar{
 			glm::mat4 scaleHtb = glm::scale(glm::vec3(scalex, scaley, 0));
 			Matrices.model *= (translateHtb*scaleHtb);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(htb);
 
 		}
@@ -586,35 +912,65 @@ class Bar{
 
 Bar bar[10];
 
-class Brick{
+#define GRAPH_MS 50.0f	// frame time at the top of the graph
+
+/* The perf overlay: a graph of the last STATS_HISTORY frame times along
+   the bottom of the screen, over guides at 60 and 30 fps. FPS and the
+   counters go in the window title while it is shown */
+class PerfOverlay{
+
 	public:
-		VAO *br,*gif[16],*top[2],*left[2],*right[2],*back[2],*bottom[2];
-		float posx;
-		float posy;
-		float posz;
-		float center[3];
-		float radius;
-		bool isThere;
-		bool isMove;
-		int index1;
-		int index2;
-		int count;
-		int dir;
-		Brick(){
-			posx = 0;
-			posy = 0;
-			posz = 0;
-			center[0] = posx;
-			center[1] = posy;
-			center[2] = posz;
-			radius = 1;
-			isThere=true;
-			isMove=false;
-			index1=0;
-			index2=0;
-			count=0;
-			dir=1;
+		VAO graph,guides;
+		bool shown;
+		PerfOverlay(){
+			shown = false;
 		}
+		void create(){
+			const GLfloat y60 = -1 + 0.5f*16.7f/GRAPH_MS, y30 = -1 + 0.5f*33.3f/GRAPH_MS;
+			const GLfloat vertex_buffer_data [] = {
+				-1,y60,0, 1,y60,0,
+				-1,y30,0, 1,y30,0,
+			};
+			guides = create3DObject(GL_LINES, 4, vertex_buffer_data, 0.5, 0.5, 0.5, GL_FILL);
+			vector<GLfloat> points(3*STATS_HISTORY, 0);
+			graph = create3DObject(GL_LINE_STRIP, STATS_HISTORY, points.data(), 1, 1, 0, GL_FILL);
+		}
+		void draw(){
+			GLfloat points[3*STATS_HISTORY];
+			int i;
+			if(!shown)
+				return;
+			// oldest on the left, in clip space
+			for(i=0;i<STATS_HISTORY;i++){
+				float ms = drawStats.frameMs(STATS_HISTORY-1-i);
+				points[3*i] = -1 + 2.0f*i/(STATS_HISTORY-1);
+				points[3*i+1] = -1 + 0.5f*(ms < GRAPH_MS ? ms : GRAPH_MS)/GRAPH_MS;
+				points[3*i+2] = 0;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, graph.VertexBuffer.id());
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(points), points);
+			drawStats.add(STAT_BYTES, sizeof(points));
+			useProgram(programID);
+			uploadMVP(glm::mat4(1.0f));
+			glDisable(GL_DEPTH_TEST);
+			draw3DObject(guides);
+			draw3DObject(graph);
+			glEnable(GL_DEPTH_TEST);
+		}
+		/* FPS, the last frame's time and its counters */
+		void text(char *buf, size_t size){
+			snprintf(buf, size, "  |  %.1f fps %.2f ms, %lld draws, %lld vertices, %lld programs, %lld textures, %lld uniforms, %lld bytes, %lld allocations",
+					drawStats.fps(), drawStats.frameMs(0), drawStats.last(STAT_DRAWS), drawStats.last(STAT_VERTICES),
+					drawStats.last(STAT_PROGRAMS), drawStats.last(STAT_TEXTURES), drawStats.last(STAT_UNIFORMS), drawStats.last(STAT_BYTES),
+					drawStats.last(STAT_ALLOCS));
+		}
+};
+
+PerfOverlay overlay;
+
+class Brick{
+	public:
+		VAO br,gif[16],top[2],left[2],right[2],back[2],bottom[2];
 		void create(){
 
 			static const GLfloat vertex_buffer_data [] = {
@@ -940,67 +1296,20 @@ class Brick{
 			right[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data, texture_buffer_data, textureID, GL_FILL);
 
 		}
-		void draw(float i,float j){
-			// Compute Camera matrix (view)
-			glUseProgram (programID);
-			if(view==3)
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			else if(view == 4)
-				Matrices.view = glm::lookAt( eye1, target1, up1 ); // Rotating Camera for 3D
-			else if(view==1)
-				Matrices.view = glm::lookAt( eye2, target2, up2 ); // Rotating Camera for 3D
-			else if(view==2)
-				Matrices.view = glm::lookAt( eye3, target3, up3 ); // Rotating Camera for 3D
-			else if(view==0)
-				Matrices.view = glm::lookAt( eye4, target4, up4 ); // Rotating Camera for 3D
-			else
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			//Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			glm::mat4 VP = Matrices.projection * Matrices.view;
-			glm::mat4 MVP;	// MVP = Projection * View * Model
-			Matrices.model = glm::mat4(1.0f);
-			posz = i;
-			posx = j;
-			if(isMove){
-				posy-=dir*(0.02 + i*0.002 + j*0.002);
-				if(posy < -2.75 || posy > 2.55)
-					dir = -1*dir;
-			}
-			glm::mat4 translateBrick = glm::translate(glm::vec3(posx, posy, posz));   
-			Matrices.model *= translateBrick;
-			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+		/* MVP comes worked out from drawWorld */
+		void draw(const glm::mat4 &MVP){
+			useProgram(programID);
+			uploadMVP(MVP);
 			draw3DObject(br);
 		}
 
-		void drawGif(float i,float j){
-			glUseProgram(textureProgramID);
-			if(view == 3)
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			else if(view == 4)
-				Matrices.view = glm::lookAt( eye1, target1, up1 ); // Rotating Camera for 3D
-			else if(view==1)
-				Matrices.view = glm::lookAt( eye2, target2, up2 ); // Rotating Camera for 3D
-			else if(view==2)
-				Matrices.view = glm::lookAt( eye3, target3, up3 ); // Rotating Camera for 3D
-			else if(view==0)
-				Matrices.view = glm::lookAt( eye4, target4, up4 ); // Rotating Camera for 3D
-			else
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			//Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			glm::mat4 VP = Matrices.projection * Matrices.view;
-			glm::mat4 MVP;	// MVP = Projection * View * Model
-			Matrices.model = glm::mat4(1.0f);
-			posz = i;
-			posx = j;
-			glm::mat4 translateBrick = glm::translate(glm::vec3(posx, posy, posz));   
-			Matrices.model *= translateBrick;
-			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-			if(index1<16)
-				draw3DTexturedObject(gif[index1]);
-			else
-				draw3DTexturedObject(gif[31-index1]);
+		/* Textured faces; frame selects the waterfall animation step */
+		void drawGif(const glm::mat4 &MVP,int frame){
+			useProgram(textureProgramID);
+			uploadMVP(MVP);
+			int index1 = frame%16;
+			int index2 = 0;
+			draw3DTexturedObject(gif[index1]);
 
 			draw3DTexturedObject(top[index2]);
 			draw3DTexturedObject(right[index2]);
@@ -1012,237 +1321,72 @@ class Brick{
 		}
 };
 
-Brick brick[100];
+// One mesh per brick kind, shared by every brick entity of that kind
+Brick brick, goalBrick;
 class Light{
 
 	public:
-		VAO *li;
-		float posx;
-		float posy;
-		float posz;
-		float center[3];
+		VAO li;
 		float radius;
-		bool show;
-		bool pause;
-		float angle;
 
 		Light(){
-			posx=4;
-			posy=2;
-			posz=8;
 			radius=0.2;
-			center[0] = posx;
-			center[1] = posy;
-			center[2] = posz;
-			show = true;
-			pause = false;
-			angle = 0;
 		}
 
-		void create()
-		{
-
-			int numVertices = 360;
-			GLfloat* vertex_buffer_data = new GLfloat [3*numVertices];
-			for (int i=0; i<numVertices; i++) {
-				vertex_buffer_data [3*i] = radius*cos(i*M_PI/180.0f);
-				vertex_buffer_data [3*i + 1] = radius*sin(i*M_PI/180.0f);
-				vertex_buffer_data [3*i + 2] = 0;
-			}
-
-
-			GLfloat* color_buffer_data = new GLfloat [3*numVertices];
-			for (int i=0; i<numVertices; i++) {
-				color_buffer_data [3*i] = 1;
-				color_buffer_data [3*i + 1] = 1;
-				color_buffer_data [3*i + 2] = 0;
-			}
-
-
-			li = create3DObject(GL_TRIANGLE_FAN, numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
+		void create(){
+			li = createModel(MODEL_COIN);
 		}
 
-		void draw(){
-			glUseProgram (programID);
-			if(view==3)
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			else if(view==4)
-				Matrices.view = glm::lookAt( eye1, target1, up1 ); // Rotating Camera for 3D
-			else if(view==1)
-				Matrices.view = glm::lookAt( eye2, target2, up2 ); // Rotating Camera for 3D
-			else if(view==2)
-				Matrices.view = glm::lookAt( eye3, target3, up3 ); // Rotating Camera for 3D
-			else if(view==0)
-				Matrices.view = glm::lookAt( eye4, target4, up4 ); // Rotating Camera for 3D
-			else
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			//Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			glm::mat4 VP = Matrices.projection * Matrices.view;
-			glm::mat4 MVP;  // MVP = Projection * View * Model
-			Matrices.model = glm::mat4(1.0f);
-			glm::mat4 moveLt = glm::translate(glm::vec3(posx,posy,posz));
-			glm::mat4 rotateLt = glm::rotate((float)(angle*M_PI/180.0f), glm::vec3(0,1,0));
-			center[0] = posx;
-			center[1] = posy;
-			center[2] = posz;
-			angle+=2;
-			Matrices.model *= moveLt*rotateLt;
-			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+		/* MVP, spin included, comes worked out from drawWorld */
+		void draw(const glm::mat4 &MVP){
+			useProgram(programID);
+			uploadMVP(MVP);
 			draw3DObject(li);
 
 		}
 };
 
-Light light[6];
+Light light;
 
 class Obstacle{
 
 	public:
-		VAO *sp;
-		float posx;
-		float posy;
-		float posz;
+		VAO sp;
 		float radius;
-		float center[3];
-		float angle;
-		int count;
-		int dir;
-		float speed;
 		Obstacle(){
-			posx=0;
-			posy=0;
-			posz=0;
 			radius=0.5;
-			center[0]=posx;
-			center[1]=posy;
-			center[2]=posz;
-			speed=0.07;
-			angle=0;
-			count=0;
-			dir=1;
 		}
 
-		void create(int slices,int stacks){
-			int n = 2 * (slices + 1) * stacks;
-			int i = 0;
-			GLfloat *points = new GLfloat[3*n];
-			GLfloat *color = new GLfloat[3*n];
-			for (float theta = -M_PI / 2; theta < M_PI / 2 - 0.0001; theta += M_PI / stacks) {
-				for (float phi = -M_PI; phi <= M_PI + 0.0001; phi += 2 * M_PI / slices) {
-
-					points[3*i] = radius*(cos(theta) * sin(phi));
-					points[3*i + 1] = radius*(-sin(theta));
-					points[3*i + 2] = radius*(cos(theta) * cos(phi));
-
-					color[3*i] = 1;
-					color[3*i + 1] = 0;
-					color[3*i + 2] = 0;
-
-					i++;
-
-					points[3*i] = radius*(cos(theta + M_PI / stacks) * sin(phi));
-					points[3*i + 1] = radius*(-sin(theta + M_PI / stacks));
-					points[3*i + 2] = radius*(cos(theta + M_PI / stacks) * cos(phi));
-
-					color[3*i] = 0.8;
-					color[3*i + 1] = 0.8;
-					color[3*i + 2] = 0.8;
-
-					i++;
-				}
-			}
-
-			sp = create3DObject(GL_TRIANGLE_STRIP, n, points, color, GL_FILL);
-
+		void create(){
+			sp = createModel(MODEL_OBSTACLE);
 		}
 
-		void draw(){
-
-			glUseProgram (programID);
-			if(view==3)
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			else if(view == 4)
-				Matrices.view = glm::lookAt( eye1, target1, up1 ); // Rotating Camera for 3D
-			else if(view==1)
-				Matrices.view = glm::lookAt( eye2, target2, up2 ); // Rotating Camera for 3D
-			else if(view==2)
-				Matrices.view = glm::lookAt( eye3, target3, up3 ); // Rotating Camera for 3D
-			else if(view==0)
-				Matrices.view = glm::lookAt( eye4, target4, up4 ); // Rotating Camera for 3D
-			else
-				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			//Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-			glm::mat4 VP = Matrices.projection * Matrices.view;
-			glm::mat4 MVP;  // MVP = Projection * View * Model
-			Matrices.model = glm::mat4(1.0f);
-			glm::mat4 moveSp = glm::translate(glm::vec3(posx,posy,posz));
-			center[0] = posx;
-			center[1] = posy;
-			center[2] = posz;
-			Matrices.model *= moveSp;
-			angle+=2;
-			count++;
-			posy += dir*speed;
-			if(center[1] < 2){
-				dir = 1;
-				center[1] = 2.1;
-			}
-			if(center[1] > 4){
-				dir = -1;
-				center[1] = 3.8;
-			}
-			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+		/* MVP comes worked out from drawWorld */
+		void draw(const glm::mat4 &MVP){
+			useProgram(programID);
+			uploadMVP(MVP);
 			draw3DObject(sp);
 
 		}
 };
 
-Obstacle obstacle[3];
+Obstacle obstacle;
 
 class Timer{
 	public:
-		VAO *clk,*hand;
+		VAO clk,hand;
 		float posx;
 		float posy;
 		float posz;
 		float radius;
-		bool show;
-		float center[3];
-		float angle;
 		Timer(){
 			posx=-5;
 			posy=6;
 			posz=0;
 			radius=0.5;
-			center[0]=posx;
-			center[1]=posy;
-			center[2]=posz;
-			show = false;
-			angle=0;
 		}	
 		void createCircle(){
-		int numVertices = 360;
-                        GLfloat* vertex_buffer_data = new GLfloat [3*numVertices];
-                        for (int i=0; i<numVertices; i++) {
-                                vertex_buffer_data [3*i] = radius*cos(i*M_PI/180.0f);
-                                vertex_buffer_data [3*i + 1] = radius*sin(i*M_PI/180.0f);
-                                vertex_buffer_data [3*i + 2] = 0;
-                        }
-
-
-                        GLfloat* color_buffer_data = new GLfloat [3*numVertices];
-                        for (int i=0; i<numVertices; i++) {
-                                color_buffer_data [3*i] = 1;
-                                color_buffer_data [3*i + 1] = 1;
-                                color_buffer_data [3*i + 2] = 1;
-                        }
-
-
-                        // create3DObject creates and returns a handle to a VAO that can be used later
-                        clk = create3DObject(GL_TRIANGLE_FAN, numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
-
+			clk = createModel(MODEL_CLOCK);
 		}
 		void createHand(){
 			 static const GLfloat vertex_buffer_data [] = {
@@ -1269,8 +1413,10 @@ class Timer{
 			
 		}
 
-		void draw(){
-			glUseProgram (programID);
+		/* ticks is how long the current power-up has been running */
+		void draw(int ticks){
+			float angle = -0.565*FRAME_TO_TICK*ticks;
+			useProgram(programID);
                         Matrices.view = glm::lookAt(glm::vec3(-1,3,4),glm::vec3(-1,3,0),up);
                         glm::mat4 VP = Matrices.projection * Matrices.view;
                         glm::mat4 MVP;  // MVP = Projection * View * Model
@@ -1278,7 +1424,7 @@ class Timer{
                         glm::mat4 translateClk = glm::translate (glm::vec3(posx, posy, 0));
                         Matrices.model *= (translateClk);
                         MVP = VP * Matrices.model;
-                        glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+                        uploadMVP(MVP);
                         draw3DObject(clk);
 			
                         Matrices.model = glm::mat4(1.0f);
@@ -1287,9 +1433,8 @@ class Timer{
                         glm::mat4 scaleHand = glm::scale(glm::vec3(0.075, 0.5, 0));
                         Matrices.model *= (translateHand*rotateHand*scaleHand);
                         MVP = VP * Matrices.model;
-                        glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+                        uploadMVP(MVP);
                         draw3DObject(hand);
-			angle-=0.565;
 		}
 		
 };
@@ -1298,160 +1443,35 @@ Timer timer;
 class Can{
 
 	public:
-		VAO *sh,*hs,*straw,*umb,*bend[2];
-		float posx;
-		float posy;
-		float posz;
+		VAO sh,hs,straw,umb,bend[2];
 		float radius;
-		bool show;
-		float center[3];
 		float angle;
 		Can(){
-			posx=5;
-			posy=3;
-			posz=8;
 			radius=0.5;
-			center[0]=posx;
-			center[1]=posy;
-			center[2]=posz;
-			show = true;
 			angle=0;
 		}
 
 		void create(){
-			float factor=0.7;
-			int numVertices = 360,i;
-			float height=0.0007;
-			int j;
-			GLfloat* vertex_buffer_data = new GLfloat [3*numVertices*1500];
-			for(j=0;j<1500;j++){
-				for (i=0; i<numVertices; i++) {
-					vertex_buffer_data [3*numVertices*j + 3*i] = factor*radius*cos(i*M_PI/180.0f);
-					vertex_buffer_data [3*numVertices*j + 3*i + 1] = height*j;
-					vertex_buffer_data [3*numVertices*j + 3*i + 2] = factor*radius*sin(i*M_PI/180.0f);
-				}
-				factor+=0.0003;
-
-			}
-
-			GLfloat* color_buffer_data = new GLfloat [3*numVertices*1500];
-
-			for(j=0;j<1500;j++){
-				for (i=0; i<numVertices; i++){
-					if(j>=1493&&j<=1499){
-						color_buffer_data [3*numVertices*j + 3*i] = 0;
-						color_buffer_data [3*numVertices*j + 3*i + 1] = 0.78;
-						color_buffer_data [3*numVertices*j + 3*i + 2] = 0.9;
-					}
-					else{
-						color_buffer_data [3*numVertices*j + 3*i] = 0.01;
-						color_buffer_data [3*numVertices*j + 3*i + 1] = 0.13;
-						color_buffer_data [3*numVertices*j + 3*i + 2] = 0.4;
-					}
-				}
-			}
-
-			sh = create3DObject(GL_TRIANGLE_FAN, 1500*numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
-
+			sh = createModel(MODEL_CAN);
 		}
 
 		void createStraw(){
-			float factor=0.1;
-			int numVertices = 360,i;
-			float height=0.001;
-			int j;
-			GLfloat* vertex_buffer_data = new GLfloat [3*numVertices*1500];
-			for(j=0;j<1500;j++){
-				for (i=0; i<numVertices; i++) {
-					vertex_buffer_data [3*numVertices*j + 3*i] = factor*radius*cos(i*M_PI/180.0f);
-					vertex_buffer_data [3*numVertices*j + 3*i + 1] = height*j;
-					vertex_buffer_data [3*numVertices*j + 3*i + 2] = factor*radius*sin(i*M_PI/180.0f);
-				}
-
-			}
-
-			GLfloat* color_buffer_data = new GLfloat [3*numVertices*1500];
-
-			for(j=0;j<1500;j++){
-				for (i=0; i<numVertices; i++){
-					color_buffer_data [3*numVertices*j + 3*i] = 0;
-					color_buffer_data [3*numVertices*j + 3*i + 1] = 0;
-					color_buffer_data [3*numVertices*j + 3*i + 2] = 0;
-				}
-			}
-
-			straw = create3DObject(GL_TRIANGLE_FAN, 1500*numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
-
+			straw = createModel(MODEL_STRAW);
 		}
 
 		void createBendyStraw(int index){
-                        float factor=0.1;
-                        int numVertices = 360,i;
-                        float height=0.001;
-                        int j;
-                        GLfloat* vertex_buffer_data = new GLfloat [3*numVertices*1500];
-                        for(j=0;j<1500;j++){
-                                for (i=0; i<numVertices; i++) {
-                                        vertex_buffer_data [3*numVertices*j + 3*i] = factor*radius*cos(i*M_PI/180.0f);
-                                        vertex_buffer_data [3*numVertices*j + 3*i + 1] = height*j;
-                                        vertex_buffer_data [3*numVertices*j + 3*i + 2] = factor*radius*sin(i*M_PI/180.0f);
-                                }
-
-                        }
-
-                        GLfloat* color_buffer_data = new GLfloat [3*numVertices*1500];
-
-                        for(j=0;j<1500;j++){
-                                for (i=0; i<numVertices; i++){
-                                        color_buffer_data [3*numVertices*j + 3*i] = 1;
-                                        color_buffer_data [3*numVertices*j + 3*i + 1] = 1;
-                                        color_buffer_data [3*numVertices*j + 3*i + 2] = 1;
-                                }
-                        }
-
-                        bend[index] = create3DObject(GL_TRIANGLE_FAN, 1500*numVertices, vertex_buffer_data, color_buffer_data, GL_FILL);
-
-                }
-
-
-		void createUmb(int slices,int stacks){
-			int n = 2 * (slices + 1) * stacks;
-			int i = 0;
-			GLfloat *points = new GLfloat[3*n];
-			GLfloat *color = new GLfloat[3*n];
-			for (float theta = -M_PI / 2; theta < M_PI/2 - 0.0001; theta += M_PI / stacks) {
-				for (float phi = -M_PI; phi <= 0.0001; phi += M_PI / slices) {
-
-					points[3*i] = radius*(cos(theta) * sin(phi));
-					points[3*i + 1] = radius*(-sin(theta));
-					points[3*i + 2] = radius*(cos(theta) * cos(phi));
-
-					color[3*i] = 1;
-					color[3*i + 1] = 0.2;
-					color[3*i + 2] = 0.6;
-
-					i++;
-
-					points[3*i] = radius*(cos(theta + M_PI / stacks) * sin(phi));
-					points[3*i + 1] = radius*(-sin(theta + M_PI / stacks));
-					points[3*i + 2] = radius*(cos(theta + M_PI / stacks) * cos(phi));
-
-					color[3*i] = 1;
-					color[3*i + 1] = 0.2;
-					color[3*i + 2] = 0.6;
-
-					i++;
-				}
-			}
+			bend[index] = createModel(MODEL_BENDY_STRAW);
+		}
 
-			umb = create3DObject(GL_TRIANGLE_STRIP, n, points, color, GL_FILL);
 
+		void createUmb(){
+			umb = createModel(MODEL_UMBRELLA);
 		}
 
 
-		void draw(){
+		void draw(float posx,float posy,float posz){
 
-			glUseProgram (programID);
+			useProgram(programID);
 			if(view==3)
 				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
 			else if(view==4)
@@ -1471,12 +1491,9 @@ class Can{
 			Matrices.model = glm::mat4(1.0f);
 			glm::mat4 moveSt = glm::translate(glm::vec3(posx-0.1,posy,posz));
 			glm::mat4 rotateSt = glm::rotate((float)(angle*M_PI/180.0f), glm::vec3(0,0,1));
-			center[0] = posx;
-			center[1] = posy;
-			center[2] = posz;
 			Matrices.model *= (moveSt*rotateSt);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(straw);
 
 
@@ -1486,7 +1503,7 @@ class Can{
 			glm::mat4 rotateB1 = glm::rotate((float)(angle*M_PI/180.0f), glm::vec3(0,0,1));
 			Matrices.model *= (moveB1*rotateB1);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(bend[0]);
 
 
@@ -1497,7 +1514,7 @@ class Can{
 			glm::mat4 scaleB2 = glm::scale(glm::vec3(1,0.3,1));
 			Matrices.model *= (moveB1*rotateB1*moveB2*rotateB2*scaleB2);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(bend[1]);
 		
 			Matrices.model = glm::mat4(1.0f);
@@ -1508,7 +1525,7 @@ class Can{
 			glm::mat4 rotateUmb2 = glm::rotate((float)(angle*M_PI/180.0f), glm::vec3(0,1,0));
 			Matrices.model *= (moveSt * rotateSt * moveUmb * rotateUmb1 * rotateUmb2);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(umb);
 
 			Matrices.model = glm::mat4(1.0f);
@@ -1516,7 +1533,7 @@ class Can{
 			//glm::mat4 rotateSh = glm::rotate((float)(angle*M_PI/180.0f), glm::vec3(0,1,0));
 			Matrices.model *= (moveSh);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(sh);
 
 		}
@@ -1524,54 +1541,9 @@ class Can{
 
 Can can;
 
-int count=0;
 class Person{
 	public:
-		VAO *per,*limb[4],*head;
-		float posx;
-		float posy;
-		float posz;
-		bool isMoving;
-		bool levitate;
-		bool onMTile;
-		bool onMTileJump;
-		bool move1;
-		int dir;
-		float t;
-		int hitno;
-		float center[3];
-		float vel;
-		float radius;
-		int lives;
-		int coins;
-		int score;
-		int speed;
-		float beforeht;
-		float beforeht1;
-		Person(){
-			isMoving=false;
-			onMTile=false;
-			onMTileJump=false;
-			move1=false;
-			posx=0;
-			posy=2.5;
-			posz=0;
-			beforeht = posy;
-			beforeht1 = posy;
-			dir=0;
-			t=0;
-			coins=0;
-			hitno=0;
-			vel=1;
-			levitate = false;
-			center[0] = posx;
-			center[1] = posy;
-			center[2] = posz;
-			lives = 3;
-			score = 0;
-			radius = sqrt(3)/2;
-			speed = 10;
-		}
+		VAO per,limb[4],head;
 
 		void create(){
 			static const GLfloat vertex_buffer_data [] = {
@@ -1678,51 +1650,8 @@ class Person{
 
 		}	
 
-		void createHead(int slices,int stacks){
-			int n = 2 * (slices + 1) * stacks;
-			int i = 0;
-			float radius = 0.375; 
-			GLfloat *points = new GLfloat[3*n];
-			GLfloat *color = new GLfloat[3*n];
-			for (float theta = -M_PI / 2; theta < M_PI / 2 - 0.0001; theta += M_PI / stacks) {
-				for (float phi = -M_PI; phi <= M_PI + 0.0001; phi += 2 * M_PI / slices) {
-
-					points[3*i] = radius*(cos(theta) * sin(phi));
-					points[3*i + 1] = radius*(-sin(theta));
-					points[3*i + 2] = radius*(cos(theta) * cos(phi));
-
-					color[3*i] = 1;
-					color[3*i + 1] = 1;
-					color[3*i + 2] = 0;
-
-					/*if(theta> -90*M_PI/180.0f && theta< -35*M_PI/180.0f){
-						color[3*i] = 0;
-						color[3*i + 1] = 0;
-						color[3*i + 2] = 0;
-					}*/
-
-					i++;
-
-					points[3*i] = radius*(cos(theta + M_PI / stacks) * sin(phi));
-					points[3*i + 1] = radius*(-sin(theta + M_PI / stacks));
-					points[3*i + 2] = radius*(cos(theta + M_PI / stacks) * cos(phi));
-
-					color[3*i] = 1;
-					color[3*i + 1] = 1;
-					color[3*i + 2] = 0;
-
-					/*if(theta > -90*M_PI/180.0f && theta< -35*M_PI/180.0f){
-						color[3*i] = 0;
-						color[3*i + 1] = 0;
-						color[3*i + 2] = 0;
-					}*/
-
-					i++;
-				}
-			}
-
-			head = create3DObject(GL_TRIANGLE_STRIP, n, points, color, GL_FILL);
-
+		void createHead(){
+			head = createModel(MODEL_HEAD);
 		}
 
 
@@ -1832,9 +1761,9 @@ class Person{
 		}	
 
 
-		void draw(){
+		void draw(float posx,float posy,float posz){
 
-			glUseProgram (programID);
+			useProgram(programID);
 			if(view==3)
 				Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
 			else if(view==4)
@@ -1852,30 +1781,23 @@ class Person{
 			glm::mat4 MVP;  // MVP = Projection * View * Model
 			Matrices.model = glm::mat4(1.0f);
 			glm::mat4 moveBody = glm::translate(glm::vec3(posx,posy,posz));
-			center[0]=posx;
-			center[1]=posy;
-			center[2]=posz;
 			Matrices.model *= moveBody;
-			if(!jump)
-				beforeht = posy;
-			if(!onMTile)
-				beforeht1 = posy;
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(per);
 
 			Matrices.model = glm::mat4(1.0f);
 			glm::mat4 moveLimb = glm::translate(glm::vec3(posx+0.2,posy-1,posz));
 			Matrices.model *= moveLimb;
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(limb[0]);
 
 			Matrices.model = glm::mat4(1.0f);
 			glm::mat4 moveLimb2 = glm::translate(glm::vec3(posx-0.2,posy-1,posz));
 			Matrices.model *= moveLimb2;
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(limb[1]);
 
 			Matrices.model = glm::mat4(1.0f);
@@ -1883,7 +1805,7 @@ class Person{
 			glm::mat4 rotateLimb3 =  glm::rotate((float)(-70*M_PI/180.0f), glm::vec3(0,0,1));
 			Matrices.model *= (moveLimb3*rotateLimb3);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(limb[2]);
 
 			Matrices.model = glm::mat4(1.0f);
@@ -1891,7 +1813,7 @@ class Person{
 			glm::mat4 rotateLimb4 =  glm::rotate((float)(70*M_PI/180.0f), glm::vec3(0,0,1));
 			Matrices.model *= (moveLimb4*rotateLimb4);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(limb[3]);
 
 			Matrices.model = glm::mat4(1.0f);
@@ -1899,172 +1821,11 @@ class Person{
 			//glm::mat4 rotateLimb4 =  glm::rotate((float)(70*M_PI/180.0f), glm::vec3(0,0,1));
 			Matrices.model *= (moveHead);
 			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			uploadMVP(MVP);
 			draw3DObject(head);
 
 		}
 
-		void move(){
-			if(!onMTile ||onMTile&&posy>=2.5){
-				if(dir==1)
-					posx++;
-				if(dir==2)
-					posz--;
-				if(dir==3)
-					posx--;
-				if(dir==4)
-					posz++;
-			}
-		}
-
-		void back(){
-
-			if(dir==1)
-				posx--;
-			if(dir==2)
-				posz++;
-			if(dir==3)
-				posx++;
-			if(dir==4)
-				posz--;
-			posy=2.5-hitno*0.1;
-			timer.show=false;
-			levitate=false;
-			center[0]=posx;
-			center[1]=posy;
-			center[2]=posz;
-			score--;
-			speed=10;
-			dir=0;
-			//if(hitno>=10){
-			//	fall();
-				/*posx=0;
-				posy=2.5;
-				posz=0;
-				lives--;
-				hitno=0;*/
-			//}
-			
-		}
-		
-		void checkObstacle(int i){
-			if(sqrt((pow(center[0] - obstacle[i].center[0],2)) +(pow(center[1] - obstacle[i].center[1],2)) + (pow(center[2] - obstacle[i].center[2],2))) <= radius + obstacle[i].radius){
-				back();
-				hitno++;
-			}
-		}
-
-
-		void checkCan(){
-
-			if(posx==can.posx && posz == can.posz && can.show){
-				can.show=false;
-				posy = 4.5;
-				levitate=true;
-				
-			}
-		}
-		void checkBelow(){
-			float x,z;
-			float index;
-			int ind1;
-			x = posx;
-			z = posz;
-			index = (10*z + x);
-			ind1 = index;
-			if(!brick[ind1].isThere && posy <= 2.5){
-				//cout << "index: " << index << endl;
-				fall();		
-			}
-
-		}
-
-		void checkBelowMoving(){
-			float x,z;
-			float index;
-			int ind1;
-			x = posx;
-			z = posz;
-			index = (10*z + x);
-			ind1 = index;
-			if(brick[ind1].isMove && !jump && !levitate){
-				onMTile=true;
-				posy = brick[ind1].posy + 2.5;		
-			}
-			else{
-				onMTile=false;
-				if(posy>=2.5){
-					posy = beforeht1;
-					if(!jump && !levitate)
-						posy = 2.5;
-				}
-			}
-		}
-		void checkBoundary(){
-			float x,z;
-			float index;
-			int ind1;
-			x = posx;
-			z = posz;
-			index = (10*z + x);
-			ind1 = index;
-			if(posx < 0 || posx > 9 || posz < 0 || posz > 9)
-				fall();		
-
-		}
-		void collectCoin(int i){
-			if(posx==light[i].posx&&posz == light[i].posz&&light[i].show){
-				light[i].show=false;
-				score+=10;
-				coins++;
-			}
-		}
-
-		void checkHealth(){
-		if(hitno>=10)
-			fall();
-		}
-		void fall(){
-			posy = -1;
-			lives--;
-			hitno=0;
-			posx=0;
-			posy=2.5;
-			posz=0;
-			count=0;
-			speed=10;
-			dir=0;
-			levitate=false;
-			timer.show=false;
-
-		}
-
-		void leap(){
-			if(jump){
-				posy += vel*deltaTime - (0.5*5*deltaTime*deltaTime);
-				if(!levitate && posy > 4.62)
-					hitno++;
-				if(posy<beforeht){
-					//cout << beforeht << endl;
-					posy=beforeht;
-					jump=false;
-				}
-				if(dir==1){
-					posx+=vel*deltaTime*0.25;
-				}
-				if(dir==2){
-					posz-=vel*deltaTime*0.25;
-				}
-				if(dir==3){
-					posx-=vel*deltaTime*0.25;
-				}
-				if(dir==4){
-					posz+=vel*deltaTime*0.25;
-				}
-			}
-
-		}
-
 };
 
 Person person;
@@ -2074,188 +1835,50 @@ Person person;
  * Customizable functions *
  **************************/
 
-void changeCam(int choice){
-	if(choice==0){
-		eye4 = glm::vec3(8,8,11);
-		target4 = glm::vec3(4,2,1);
-
-		eye4x = 8;
-		eye4y = 8;
-		eye4z = 11;
-
-		target4x = 4;	
-		target4y = 2;	
-		target4z = 1;	
-
-	}
-	else if(choice==1){
-		eye4 = glm::vec3(8,8,-11);
-		target4 = glm::vec3(4,2,-1);
-
-		eye4x = 8;
-		eye4y = 8;
-		eye4z = -11;
-
-		target4x = 4;	
-		target4y = 2;	
-		target4z = -1;	
-
-	}
-
-	else if(choice==2){
-		eye4 = glm::vec3(-8,8,-11);
-		target4 = glm::vec3(-4,2,-1);
-
-		eye4x = -8;
-		eye4y = 8;
-		eye4z = -11;
-
-		target4x = -4;	
-		target4y = 2;	
-		target4z = -1;	
-
-	}
-
-	else if(choice==3){
-		eye4 = glm::vec3(-8,8,11);
-		target4 = glm::vec3(-4,2,1);
-
-		eye4x = -8;
-		eye4y = 8;
-		eye4z = 11;
-
-		target4x = -4;	
-		target4y = 2;	
-		target4z = 1;	
+/* Callbacks only queue events; World::input applies them at the next tick */
+void pushInput (int type, int code, int action, double x, double y)
+{
+	InputEvent ev;
+	ev.time = glfwGetTime();
+	ev.stamp = profileNow();
+	ev.type = type;
+	ev.code = code;
+	ev.action = action;
+	ev.x = x;
+	ev.y = y;
+	inputs.push(ev);
+}
 
+int keyCode (int key)
+{
+	switch (key) {
+		case GLFW_KEY_UP: return KEY_UP;
+		case GLFW_KEY_DOWN: return KEY_DOWN;
+		case GLFW_KEY_LEFT: return KEY_LEFT;
+		case GLFW_KEY_RIGHT: return KEY_RIGHT;
+		case GLFW_KEY_SPACE: return KEY_SPACE;
+		case GLFW_KEY_T: return KEY_T;
+		case GLFW_KEY_C: return KEY_C;
+		case GLFW_KEY_F: return KEY_F;
+		case GLFW_KEY_S: return KEY_S;
+		case GLFW_KEY_P: return KEY_P;
+		default: return KEY_OTHER;
 	}
-
 }
 
-
-
-
 void keyboard (GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-	// Function is called first on GLFW_PRESS.
-
-	if (action == GLFW_RELEASE) {
-		switch (key) {
-			case GLFW_KEY_T:
-				view=(view+1)%5;
-				break;
-			case GLFW_KEY_SPACE:
-				jump=false;
-				deltaTime=0;
-				person.t=0;
-				person.dir=0;
-				person.posx = (int)person.posx;
-				person.posy = person.beforeht;
-				if(person.onMTileJump){
-					person.posy=2.5;
-					person.onMTileJump=false;
-				}
-				person.posz = (int)person.posz;
-				break;
-			case GLFW_KEY_F:
-				person.speed-=1;
-				if(person.speed<=2){
-					person.speed=2;
-				}
-				break;
-			case GLFW_KEY_S:
-				person.speed+=1;
-				break;
-			case GLFW_KEY_P:
-				person.dir=0;
-				break;
-			case GLFW_KEY_C:
-				choice=(choice+1)%4;
-				changeCam(choice);
-				break;
-			case GLFW_KEY_UP:
-				person.move1=false;
-				break;
-			case GLFW_KEY_DOWN:
-				person.move1=false;
-				break;
-			case GLFW_KEY_LEFT:
-				person.move1=false;
-				break;
-			case GLFW_KEY_RIGHT:
-				person.move1=false;
-				break;
-			default:
-				break;
-		}
-	}
-	else if (action == GLFW_PRESS) {
-		switch (key) {
-			case GLFW_KEY_ESCAPE:
-				quit(window);
-				break;
-			case GLFW_KEY_SPACE:
-				if(person.onMTile && person.posy < 2.5){
-					person.dir=0;
-					person.onMTileJump=true;
-				}
-				//else	
-				jump=true;	
-				break;
-			case GLFW_KEY_UP:
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posz+=1;
-					person.dir=4;
-				}	
-				else{		
-					person.posz-=1;
-					person.dir=2;
-				}
-				break;
-			case GLFW_KEY_DOWN:
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posz-=1;
-					person.dir=2;
-				}
-
-				else{		
-					person.posz+=1;
-					person.dir=4;
-				}
-				break;
-			case GLFW_KEY_LEFT:
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posx+=1;
-					person.dir=1;
-				}
-
-				else{
-					person.posx-=1;
-					person.dir=3;
-				}
-				break;
-			case GLFW_KEY_RIGHT:
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posx-=1;
-					person.dir=3;
-				}
-
-				else{
-					person.posx+=1;
-					person.dir=1;
-				}
-				break;
-			default:
-				break;
-		}
+	if (action == GLFW_PRESS && key == GLFW_KEY_ESCAPE)
+		quit(window);
+	if (action == GLFW_PRESS && key == GLFW_KEY_F3)
+		overlay.shown = !overlay.shown;
+	if (action == GLFW_PRESS && key == GLFW_KEY_F12 && profilePath)
+		fprintf(stderr, "%ld events written to %s\n", profileDump(profilePath), profilePath);
+	// Key repeats are ignored, holding a direction is handled by the simulation
+	if (action == GLFW_RELEASE || action == GLFW_PRESS) {
+		int code = keyCode(key);
+		if (code != KEY_OTHER)
+			pushInput(INPUT_KEY, code, action == GLFW_PRESS ? ACTION_PRESS : ACTION_RELEASE, 0, 0);
 	}
 }
 
@@ -2287,122 +1910,28 @@ void keyboardChar (GLFWwindow* window, unsigned int key)
 }
 
 /* Executed when a mouse button is pressed/released */
-bool pressNext=false;
-bool pressMove=false;
-int moves;
 void mouse_callback(GLFWwindow* window,double x,double y){
-	if(pressNext){
-		target4=glm::vec3(x/75-4,1,y/75-4);
-	}
-
+	pushInput(INPUT_CURSOR, 0, 0, x, y);
 }
 
 void mouseButton (GLFWwindow* window, int button, int action, int mods)
 {
+	int code;
 	switch (button) {
 		case GLFW_MOUSE_BUTTON_LEFT:
-			if (action == GLFW_PRESS){
-				pressNext=true;
-			}
-			if (action == GLFW_RELEASE){
-				pressNext=false;
-			}
+			code = BUTTON_LEFT;
 			break;
 		case GLFW_MOUSE_BUTTON_RIGHT:
-			if (action == GLFW_PRESS){
-				pressMove=true;
-				person.move1=true;
-			}
-			if (action == GLFW_RELEASE){
-				pressMove=false;
-				person.move1=false;
-				moves=0;
-			}
+			code = BUTTON_RIGHT;
 			break;
 		default:
-			break;
+			return;
 	}
+	pushInput(INPUT_BUTTON, code, action == GLFW_PRESS ? ACTION_PRESS : ACTION_RELEASE, 0, 0);
 }
 
-float zoom_x,zoom_y,zoom_z;
 void scroll(GLFWwindow* window,double x,double y){
-	if(pressNext){
-	if(choice==0)
-		eye4 = glm::vec3(eye4x+zoom_x,eye4y+zoom_y,eye4z+zoom_z);	
-	else if(choice==1)
-		eye4 = glm::vec3(eye4x+zoom_x,eye4y+zoom_y,eye4z-zoom_z);	
-	else if(choice==2)
-		eye4 = glm::vec3(eye4x-zoom_x,eye4y+zoom_y,eye4z-zoom_z);	
-	else if(choice==3)
-		eye4 = glm::vec3(eye4x-zoom_x,eye4y+zoom_y,eye4z+zoom_z);	
-	zoom_x += -y*0.5;
-	zoom_y += -y*0.5;
-	zoom_z += -y*0.5;
-	}
-	if(pressMove && moves%person.speed==0){
-		moves++;
-		if(x==1){
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posx+=1;
-					person.dir=1;
-				}
-
-				else{
-					person.posx-=1;
-					person.dir=3;
-				}
-
-		}
-		else if(x==-1){
-
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posx-=1;
-					person.dir=3;
-				}
-
-				else{
-					person.posx+=1;
-					person.dir=1;
-				}
-
-		}
-		else if(y==1){
-				
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posz+=1;
-					person.dir=4;
-				}	
-				else{		
-					person.posz-=1;
-					person.dir=2;
-				}
-
-
-		}
-		
-		else if(y==-1){
-				person.move1=true;
-				if(person.onMTile && person.posy < 2.5);
-				else if(view==1||view==2||choice==1||choice==2){
-					person.posz-=1;
-					person.dir=2;
-				}
-
-				else{		
-					person.posz+=1;
-					person.dir=4;
-				}
-
-
-		}	
-	}
-
+	pushInput(INPUT_SCROLL, 0, 0, x, y);
 }
 
 /* Executed when window is resized to 'width' and 'height' */
@@ -2436,7 +1965,7 @@ void reshapeWindow (GLFWwindow* window, int width, int height)
 
 /* Initialise glfw window, I/O callbacks and the renderer to use */
 /* Nothing to Edit here */
-GLFWwindow* initGLFW (int width, int height)
+GLFWwindow* initGLFW (int width, int height, bool hidden)
 {
 	GLFWwindow* window; // window desciptor/handle
 
@@ -2449,6 +1978,8 @@ GLFWwindow* initGLFW (int width, int height)
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if(hidden)
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
 
 	window = glfwCreateWindow(width, height, "Sample OpenGL 3.3 Application", NULL, NULL);
 
@@ -2459,7 +1990,7 @@ GLFWwindow* initGLFW (int width, int height)
 
 	glfwMakeContextCurrent(window);
 	gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
-	glfwSwapInterval( 1 );
+	glfwSwapInterval( hidden ? 0 : 1 ); // nothing to wait for off screen
 
 	/* --- register callbacks with GLFW --- */
 
@@ -2486,64 +2017,32 @@ GLFWwindow* initGLFW (int width, int height)
 
 /* Initialize the OpenGL rendering properties */
 /* Add all the models to be created here */
-void initGL (GLFWwindow* window, int width, int height)
+/* Every untextured model, and the bricks' body */
+void createModels ()
 {
+	PROFILE("models");
 	int i;
-	int x=0,z=0;
-	int num;
-	pressNext=false;
-	for(i=0;i<8;i++){
-		num = rand()%100;
-		brick[num].isThere = false;
-	}
-	for(i=0;i<100;i++){
-		brick[i].create();
-	}
-	for(i=0;i<5;i++){
-		num = rand()%100;
-		brick[num].isMove = true;
-		brick[num].isThere = true;
-	}
-	brick[0].isThere = true;
-	brick[1].isThere = true;
-	brick[99].isThere = true;
-	brick[0].isMove = false;
-	brick[1].isMove = false;
-	brick[99].isMove = false;
+	brick.create();
+	goalBrick.create();
 	bg.createAxes();
 	person.create();
 	person.createLimb(0);
 	person.createLimb(1);
 	person.createLimb(2);
 	person.createLimb(3);
-	person.createHead(30,30);
+	person.createHead();
 	for(i=0;i<10;i++)
 		bar[i].create(i);
 	timer.createCircle();
 	timer.createHand();
-	for(i=0;i<3;i++){
-		obstacle[i].posx = rand()%9 + 1;
-		obstacle[i].posy = 2;
-		obstacle[i].posz = rand()%9 + 1;
-		obstacle[i].speed = (((float)(rand()%50))/1000) + 0.04;
-		obstacle[i].create(30,30);
-		//cout << obstacle[i].speed << endl;
-	}
-	can.posx = rand()%5 + 3;
-	can.posz = rand()%5 + 3;
+	overlay.create();
+	obstacle.create();
 	can.create();
 	can.createStraw();
 	can.createBendyStraw(0);
 	can.createBendyStraw(1);
-	can.createUmb(30,30);
-	brick[86].isThere = false;
-	for(i=0;i<6;i++){
-		light[i].posx = rand()%10;
-		light[i].posy = 2;
-		light[i].posz = rand()%10;
-
-		light[i].create();
-	}
+	can.createUmb();
+	light.create();
 	heart[3].posx = 1.90 + 3;
 	heart[3].posy = 3.45 + 5;
 	heart[2].posx = 2.40 + 3;
@@ -2557,72 +2056,91 @@ void initGL (GLFWwindow* window, int width, int height)
 		heart[i].createLeft(1);
 		heart[i].createRight(2);
 	}
+}
+
+void initGL (GLFWwindow* window, int width, int height)
+{
+	PROFILE("initGL");
+	int i;
+	createModels();
+	startup.mark("models");
 
 	glActiveTexture(GL_TEXTURE0);
 
-	GLuint textureID1 = createTexture("frame-001.png");
-	GLuint textureID2 = createTexture("frame-002.png");
-	GLuint textureID3 = createTexture("frame-003.png");
-	GLuint textureID4 = createTexture("frame-004.png");
-	GLuint textureID5 = createTexture("frame-005.png");
-	GLuint textureID6 = createTexture("frame-006.png");
-	GLuint textureID7 = createTexture("frame-007.png");
-	GLuint textureID8 = createTexture("frame-008.png");
-	GLuint textureID9 = createTexture("frame-009.png");
-	GLuint textureID10 = createTexture("frame-010.png");
-	GLuint textureID11 = createTexture("frame-011.png");
-	GLuint textureID12 = createTexture("frame-012.png");
-	GLuint textureID13 = createTexture("frame-013.png");
-	GLuint textureID14 = createTexture("frame-014.png");
-	GLuint textureID15 = createTexture("frame-015.png");
-	GLuint textureID16 = createTexture("frame-016.png");	
-	GLuint textureID17 = createTexture("sand2.png");	
-	GLuint textureID18 = createTexture("sand2.png");	
-	GLuint textureID19 = createTexture("win.png");	
-
-
-	textureProgramID = LoadShaders( "TextureRender.vert", "TextureRender.frag" );
+	// 16 waterfall frames, two sand faces and the goal's top
+	const char *textureFiles[19] = {
+		"frame-001.png", "frame-002.png", "frame-003.png", "frame-004.png",
+		"frame-005.png", "frame-006.png", "frame-007.png", "frame-008.png",
+		"frame-009.png", "frame-010.png", "frame-011.png", "frame-012.png",
+		"frame-013.png", "frame-014.png", "frame-015.png", "frame-016.png",
+		"sand2.png", "sand2.png", "win.png"
+	};
+	// each file is decoded once however many faces use it
+	TextureLoad loads[19];
+	TextureBatch batch = { loads, 0 };
+	GLuint textureIDs[19];
+	int slot[19];
+	for(i=0;i<19;i++){
+		for(slot[i]=0;slot[i]<batch.count;slot[i]++)
+			if(!strcmp(loads[slot[i]].path, textureFiles[i]))
+				break;
+		if(slot[i] == batch.count){
+			TextureLoad &load = loads[batch.count++];
+			const PackEntry *packed = assets.find(textureFiles[i], PACK_TEXTURE);
+			load.path = textureFiles[i];
+			load.image = NULL;
+			if(packed)
+				load.texture = createPackedTexture(packed);
+			load.decoded = load.texture.id() != 0;
+		}
+	}
+	jobs->parallelFor(0, batch.count, 1, decodeTextures, &batch);
+	uploadDecoded(batch);
+	for(i=0;i<19;i++)
+		textureIDs[i] = loads[slot[i]].texture.id();
+	for(i=0;i<batch.count;i++)
+		textures.push_back(move(loads[i].texture));
+	GLuint textureID17 = textureIDs[16];
+	GLuint textureID18 = textureIDs[17];
+	GLuint textureID19 = textureIDs[18];
+	startup.mark("textures");
+
+
+	textureProgram = GpuHandle(GPU_PROGRAM, LoadShaders( "TextureRender.vert", "TextureRender.frag" ));
+	textureProgramID = textureProgram.id();
 	// Get a handle for our "MVP" uniform
 	Matrices.TexMatrixID = glGetUniformLocation(textureProgramID, "MVP");
+	startup.mark("shaders");
 
 
 	/* Objects should be created before any other gl function and shaders */
 	// Create the models
 	//createTriangle (); // Generate the VAO, VBOs, vertices data & copy into the array buffer
-	for(i=0;i<100;i++){
-		brick[i].createFront(textureID1,0);
-		brick[i].createFront(textureID2,1);
-		brick[i].createFront(textureID3,2);
-		brick[i].createFront(textureID4,3);
-		brick[i].createFront(textureID5,4);
-		brick[i].createFront(textureID6,5);
-		brick[i].createFront(textureID7,6);
-		brick[i].createFront(textureID8,7);
-		brick[i].createFront(textureID9,8);
-		brick[i].createFront(textureID10,9);
-		brick[i].createFront(textureID11,10);
-		brick[i].createFront(textureID12,11);
-		brick[i].createFront(textureID13,12);
-		brick[i].createFront(textureID14,13);
-		brick[i].createFront(textureID15,14);
-		brick[i].createFront(textureID16,15);
-		brick[i].createUp(textureID17,0);
-		brick[i].createUp(textureID18,1);
-		brick[i].createDown(textureID17,0);
-		brick[i].createDown(textureID18,1);
-		brick[i].createRight(textureID17,0);
-		brick[i].createRight(textureID18,1);
-		brick[i].createLeft(textureID17,0);
-		brick[i].createLeft(textureID18,1);
-		brick[i].createBack(textureID17,0);
-		brick[i].createBack(textureID18,1);
+	Brick *kinds[2] = { &brick, &goalBrick };
+	for(i=0;i<2;i++){
+		int j;
+		for(j=0;j<16;j++)
+			kinds[i]->createFront(textureIDs[j],j);
+		kinds[i]->createUp(textureID17,0);
+		kinds[i]->createUp(textureID18,1);
+		kinds[i]->createDown(textureID17,0);
+		kinds[i]->createDown(textureID18,1);
+		kinds[i]->createRight(textureID17,0);
+		kinds[i]->createRight(textureID18,1);
+		kinds[i]->createLeft(textureID17,0);
+		kinds[i]->createLeft(textureID18,1);
+		kinds[i]->createBack(textureID17,0);
+		kinds[i]->createBack(textureID18,1);
 	}
-		brick[99].createUp(textureID19,0);
-		brick[99].createUp(textureID19,1);
+		goalBrick.createUp(textureID19,0);
+		goalBrick.createUp(textureID19,1);
+	startup.mark("textured models");
 	// Create and compile our GLSL program from the shaders
-	programID = LoadShaders( "Sample_GL.vert", "Sample_GL.frag" );
+	program = GpuHandle(GPU_PROGRAM, LoadShaders( "Sample_GL.vert", "Sample_GL.frag" ));
+	programID = program.id();
 	// Get a handle for our "MVP" uniform
 	Matrices.MatrixID = glGetUniformLocation(programID, "MVP");
+	startup.mark("shaders");
 
 
 	reshapeWindow (window, width, height);
@@ -2636,121 +2154,633 @@ void initGL (GLFWwindow* window, int width, int height)
 
 }
 
-int main (int argc, char** argv)
+/* Camera matrix for the current view */
+glm::mat4 cameraView ()
 {
-	int width = 600;
-	int height = 600;
-	int counter=0,move_count=0;
-	stringstream ss1;
-	string convStr1,concatStr;
-	GLFWwindow* window = initGLFW(width, height);
-	initGL (window, width, height);
-	double last_update_time = glfwGetTime(), current_time;
-	while (!glfwWindowShouldClose(window)) {
-		int i,j;
+	if(view==1)
+		return glm::lookAt( eye2, target2, up2 );
+	if(view==2)
+		return glm::lookAt( eye3, target3, up3 );
+	if(view==0)
+		return glm::lookAt( eye4, target4, up4 );
+	if(view==4)
+		return glm::lookAt( eye1, target1, up1 );
+	return glm::lookAt( eye, target, up );
+}
+
+/* Anything further than this from an entity's position is not part of its mesh */
+#define CULL_RADIUS 2.0f
+
+/* Per-entity results of a frame, worked out on the job system before
+   any GL call is made */
+struct DrawList {
+	const Frame *frame;
+	glm::mat4 VP;
+	glm::vec4 planes[6];	// view frustum, normals pointing inwards
+	vector<glm::mat4> mvp;
+	vector<unsigned char> drawn;
+	vector<int> visible[MESH_CAN+1];	// the drawn entities of each mesh
+} drawList;
+
+/* Frustum culling against a bounding sphere, then the MVP matrix of
+   every entity that is left */
+void transformRange (void *ctx, long begin, long end, int)
+{
+	DrawList &d = *(DrawList *)ctx;
+	const Frame &f = *d.frame;
+	long i;
+	int k;
+	for(i=begin;i<end;i++){
+		d.drawn[i] = 0;
+		if(f.mesh[i] == MESH_NONE)
+			continue;
+		glm::vec3 pos(f.x[i], f.y[i], f.z[i]);
+		for(k=0;k<6;k++)
+			if(glm::dot(glm::vec3(d.planes[k]), pos) + d.planes[k].w < -CULL_RADIUS)
+				break;
+		if(k < 6)
+			continue;
+		d.drawn[i] = 1;
+		glm::mat4 model = glm::translate(pos);
+		if(f.mesh[i] == MESH_COIN)
+			model *= glm::rotate((float)(f.angle[i]*M_PI/180.0f), glm::vec3(0,1,0));
+		d.mvp[i] = d.VP * model;
+	}
+}
+
+/* Draw every visible entity of a frame with the mesh its renderable
+   component names, one render pass per kind of mesh */
+void drawWorld (const Frame &f)
+{
+	PROFILE("drawWorld");
+	int i, k;
+	const float *x = f.x.data();
+	const float *y = f.y.data();
+	const float *z = f.z.data();
+	DrawList &d = drawList;
+
+	d.frame = &f;
+	d.VP = Matrices.projection * cameraView();
+	for(k=0;k<3;k++){
+		glm::vec4 row(d.VP[0][k], d.VP[1][k], d.VP[2][k], d.VP[3][k]);
+		glm::vec4 w(d.VP[0][3], d.VP[1][3], d.VP[2][3], d.VP[3][3]);
+		d.planes[2*k] = w + row;
+		d.planes[2*k+1] = w - row;
+	}
+	for(k=0;k<6;k++)
+		d.planes[k] /= glm::length(glm::vec3(d.planes[k]));
+	d.mvp.resize(f.count);
+	d.drawn.resize(f.count);
+	{
+		PROFILE("cull and transform");
+		jobs->parallelFor(0, f.count, 256, transformRange, &d);
+	}
+
+	PROFILE("draw entities");
+	for(k=0;k<=MESH_CAN;k++)
+		d.visible[k].clear();
+	for(i=0;i<f.count;i++)
+		if(d.drawn[i])
+			d.visible[f.mesh[i]].push_back(i);
+
+	// Nothing is blended, so the meshes can go in passes, one kind after
+	// another, each timed as a whole
+	const vector<int> &bricks = d.visible[MESH_BRICK], &goals = d.visible[MESH_GOAL_BRICK];
+	gpuTimers.begin(PASS_BRICKS);
+	for(k=0;k<(int)bricks.size();k++)
+		brick.draw(d.mvp[bricks[k]]);
+	for(k=0;k<(int)goals.size();k++)
+		goalBrick.draw(d.mvp[goals[k]]);
+	gpuTimers.end();
+
+	gpuTimers.begin(PASS_TEXTURED);
+	for(k=0;k<(int)bricks.size();k++)
+		brick.drawGif(d.mvp[bricks[k]],f.tick);
+	for(k=0;k<(int)goals.size();k++)
+		goalBrick.drawGif(d.mvp[goals[k]],f.tick);
+	gpuTimers.end();
+
+	gpuTimers.begin(PASS_CHARACTERS);
+	for(k=0;k<(int)d.visible[MESH_PERSON].size();k++){
+		PROFILE("person");
+		i = d.visible[MESH_PERSON][k];
+		person.draw(x[i],y[i],z[i]);
+	}
+	gpuTimers.end();
+
+	// coins count with the obstacles
+	gpuTimers.begin(PASS_OBSTACLES);
+	for(k=0;k<(int)d.visible[MESH_OBSTACLE].size();k++)
+		obstacle.draw(d.mvp[d.visible[MESH_OBSTACLE][k]]);
+	for(k=0;k<(int)d.visible[MESH_COIN].size();k++)
+		light.draw(d.mvp[d.visible[MESH_COIN][k]]);
+	gpuTimers.end();
+
+	gpuTimers.begin(PASS_CAN);
+	for(k=0;k<(int)d.visible[MESH_CAN].size();k++){
+		PROFILE("can");
+		i = d.visible[MESH_CAN][k];
+		can.draw(x[i],y[i],z[i]);
+	}
+	gpuTimers.end();
+}
+
+/* One simulation tick: queued input first, then the world's step */
+void runTick (vector<InputEvent> &botInputs)
+{
+	PROFILE("tick");
+	InputEvent ev;
+	long long now = profileNow();
+	int i;
+	while (inputs.pop(ev)) {
+		if (replay.active())
+			continue;	// a replay ignores live input
+		latency.consumed(ev.stamp, now);
+		recorder.record(world.tick, ev);
+		world.input(ev);
+	}
+	if (replay.active())
+		replay.feed(world);
+	else if (useBot) {
+		PROFILE("bot");
+		botInputs.clear();
+		bot.think(world, botInputs);
+		for (i=0;i<(int)botInputs.size();i++) {
+			recorder.record(world.tick, botInputs[i]);
+			world.input(botInputs[i]);
+		}
+	}
+	world.step();
+}
+
+/* Simulation thread: ticks on a fixed schedule of its own, so a stalled
+   swap on the render thread no longer delays gameplay. Ticks that fall
+   behind are run back to back. */
+void simulate ()
+{
+	vector<InputEvent> botInputs;
+	profileThread("simulation");
+	if (perfCounting)
+		perfSim.open();
+	chrono::steady_clock::duration tick = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(TICK_SECONDS));
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	while (simRunning) {
+		next += tick;
+		this_thread::sleep_until(next);
+		perfSim.begin(PHASE_SIM);
+		runTick(botInputs);
+		perfSim.end();
+		{
+			PROFILE("capture frame");
+			frames.back().capture(world);
+			frames.back().lastInput = latency.published(profileNow());
+			frames.publish();
+		}
+		if (world.status != STATUS_PLAYING || (replay.active() && replay.finished && world.tick >= replay.endTick)) {
+			simDone = world.status == STATUS_PLAYING;
+			return;
+		}
+	}
+}
+
+/* Everything drawn for one frame, up to the swap. Allocates nothing */
+void renderFrame (GLFWwindow *window, const Frame &f)
+{
+	static char title[512], shown[512];
+	int i, n;
+	float px,py,pz;
+	{
+		PROFILE("clear and title");
 		bg.clean1();
 		bg.draw();
-		ss1.str("");
-		ss1 << person.score;
-		convStr1 = ss1.str();
-		concatStr = "Waterfall Maze!!!\t\t\t\t\t Score: " + convStr1;
-		const char *gameTitle = concatStr.c_str();
-		glfwSetWindowTitle(window,gameTitle);
-
-		for(i=0;i<10;i++)
-		{
-			for(j=0;j<10;j++){
-				if(brick[(10*i)+j].isThere){
-					brick[(10*i)+j].draw(i,j);
-					brick[(10*i)+j].drawGif(i,j);
-				}
-			}
+		n = snprintf(title, sizeof(title), "Waterfall Maze!!!\t\t\t\t\t Score: %d", f.score);
+		if(overlay.shown && n < (int)sizeof(title))
+			overlay.text(title + n, sizeof(title) - n);
+		// the window system is only told when it changes
+		if(strcmp(title, shown)){
+			glfwSetWindowTitle(window,title);
+			strcpy(shown, title);
 		}
+	}
 
-		for(i=0;i<person.lives;i++){
+	view = f.view;
+	eye4 = glm::vec3(f.eye[0],f.eye[1],f.eye[2]);
+	target4 = glm::vec3(f.target[0],f.target[1],f.target[2]);
+	drawWorld(f);
+
+	{
+		PROFILE("hud");
+		gpuTimers.begin(PASS_HUD);
+		for(i=0;i<f.lives;i++){
 			heart[i].draw(0);
 			heart[i].draw(1);
 			heart[i].draw(2);
 		}
-		if(can.show)
-			can.draw();
-		for(i=0;i<6;i++){
-			if(light[i].show)
-				light[i].draw();
-			person.collectCoin(i);
-		}
-
-		person.draw();
-		for(i=0;i<10-person.hitno;i++)
+		for(i=0;i<10-f.hitno;i++)
 			bar[i].draw(6,6+0.2*i,0.25,0.1);
-		for(i=0;i<3;i++)
-			obstacle[i].draw();
-		if(timer.show)
-			timer.draw();
-		person.checkBelow();
-		person.checkBelowMoving();
-		person.checkCan();
-		for(i=0;i<3;i++){
-			person.checkObstacle(i);
+		if(f.levitate)
+			timer.draw(f.levitateTicks);
+		overlay.draw();
+		gpuTimers.end();
+	}
+	gpuTimers.frameDone();
+
+	px = f.player[0];
+	py = f.player[1];
+	pz = f.player[2];
+	eye2=glm::vec3(px,py,pz+0.5);
+	target2=glm::vec3(px,py,pz+2);
+
+	eye3=glm::vec3(px,py+1,pz-1.5);
+	target3=glm::vec3(px,py,pz+2);
+}
+
+#define BENCH_WARMUP 60	// frames run before timing starts
+
+/* One benchmark: a level, the camera and whether the can is drawn */
+struct BenchScenario {
+	string name;
+	int view;	// as toggled with T
+	int choice;	// helicopter position, as changed with C
+	int width, depth, coins, obstacles, movingPercent, cans;
+	bool can;
+	unsigned int seed;	// the default level's; --seed replaces it when the run starts
+};
+
+static const BenchScenario benchScenarios[] = {
+	{ "view0-heli0", 0, 0, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view0-heli1", 0, 1, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view0-heli2", 0, 2, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view0-heli3", 0, 3, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view1-first-person", 1, 0, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view2", 2, 0, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view3", 3, 0, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "view4", 4, 0, 10, 10, 6, 3, 5, 1, true, 1 },
+	{ "size-20x20", 0, 0, 20, 20, 6, 3, 5, 1, true, 1 },
+	{ "size-40x40", 0, 0, 40, 40, 6, 3, 5, 1, true, 1 },
+	{ "size-80x80", 0, 0, 80, 80, 6, 3, 5, 1, true, 1 },
+	{ "obstacles-40", 0, 0, 20, 20, 6, 40, 5, 1, true, 1 },
+	{ "can-hidden", 0, 0, 10, 10, 6, 3, 5, 1, false, 1 },
+};
+
+/* The scenarios of a sweep: the level at every point of it, seen from
+   the default camera with the can drawn */
+void sweepScenarios (const ReplayHeader &level, const Sweep &sweep, vector<BenchScenario> &scenarios)
+{
+	size_t i;
+	const char *problem;
+	for(i=0;i<sweep.values.size();i++){
+		ReplayHeader at = sweepLevel(level, sweep, i);
+		BenchScenario b = { sweepName(sweep, i), 0, 0, at.width, at.depth, at.coins, at.obstacles, at.movingPercent, at.cans, true, at.seed };
+		problem = checkLevel(at);
+		if(problem){
+			fprintf(stderr, "%s: %s\n", b.name.c_str(), problem);
+			exit(EXIT_FAILURE);
 		}
+		scenarios.push_back(b);
+	}
+}
 
-		person.checkBoundary();
-		person.checkHealth();
-		person.leap();
+/* Run every scenario for frames frames on the render thread, one sim
+   tick per frame with no input, and write the results to path. The sim
+   thread is not running: the tick is timed on its own, and the frame
+   time covers the tick, the drawing and a glFinish() after the swap.
+   Frames that start a lost or won level over go into no figure but the
+   count of restarts. */
+int runBench (GLFWwindow *window, const char *path, long frames, bool noAlloc, const vector<BenchScenario> &scenarios)
+{
+	double load[PERF_COUNTERS];	// kept before the scenarios reset the counts
+	bool loaded = perfMain.calls(PHASE_LOAD) > 0;
+	vector<BenchResult> results;
+	vector<double> ms;
+	Frame f;
+	long n, i, failed = 0;
+	long long start, ticked, tickNs;
+	size_t s;
+	int p, k;
+	bool restarted;
+	AllocCount frameStart, phaseStart, sim, draw, frame;
+
+	ms.reserve(frames);
+	for(k=0;k<PERF_COUNTERS;k++)
+		load[k] = perfMain.has(k) ? perfMain.total(PHASE_LOAD, k) : -1;
+
+	for(s=0;s<scenarios.size();s++){
+		const BenchScenario &b = scenarios[s];
+		BenchResult r;
+		world.generate(b.width, b.depth, b.coins, b.obstacles, b.seed, b.movingPercent, b.cans);
+		r.seed = b.seed;
+		r.width = b.width;
+		r.depth = b.depth;
+		r.coins = b.coins;
+		r.obstacles = b.obstacles;
+		r.movingPercent = b.movingPercent;
+		r.cans = b.cans;
+		r.entities = world.count;
+		world.changeCam(b.choice);
+		world.ctl.view = b.view;
+		ms.clear();
+		tickNs = 0;
+		r.simAllocs = r.drawAllocs = r.frameAllocs = r.allocBytes = 0;
+		r.allocatingFrames = 0;
+		r.restarts = 0;
+		for(n=0;n<BENCH_WARMUP+frames;n++){
+			frameStart = allocCount();
+			restarted = world.status != STATUS_PLAYING;
+			if(restarted){
+				world.generate(b.width, b.depth, b.coins, b.obstacles, b.seed, b.movingPercent, b.cans);
+				world.changeCam(b.choice);
+				world.ctl.view = b.view;
+			}
+			if(n == BENCH_WARMUP)
+				perfMain.reset();
+			start = profileNow();
+			phaseStart = allocCount();
+			// restart frames stay out of the counters as out of the rest
+			if(!restarted)
+				perfMain.begin(PHASE_SIM);
+			world.step();
+			perfMain.end();
+			ticked = profileNow();
+			sim = allocSince(phaseStart);
+			f.capture(world);
+			if(!b.can)
+				for(i=0;i<f.count;i++)
+					if(f.mesh[i] == MESH_CAN)
+						f.mesh[i] = MESH_NONE;
+			phaseStart = allocCount();
+			if(!restarted)
+				perfMain.begin(PHASE_DRAW);
+			renderFrame(window, f);
+			perfMain.end();
+			draw = allocSince(phaseStart);
+			glfwSwapBuffers(window);
+			glFinish();
+			glfwPollEvents();
+			frame = allocSince(frameStart);
+			drawStats.add(STAT_ALLOCS, frame.allocs);
+			drawStats.add(STAT_ALLOC_BYTES, frame.bytes);
+			drawStats.frameDone((profileNow() - start)/1e6);
+			if(n < BENCH_WARMUP)
+				continue;
+			// a level that starts over is not the steady state: counted, not timed
+			if(restarted){
+				r.restarts++;
+				continue;
+			}
+			ms.push_back((profileNow() - start)/1e6);
+			tickNs += ticked - start;
+			r.simAllocs += sim.allocs;
+			r.drawAllocs += draw.allocs;
+			r.frameAllocs += frame.allocs;
+			r.allocBytes += frame.bytes;
+			if(frame.allocs)
+				r.allocatingFrames++;
+		}
+		r.name = b.name;
+		summarizeFrames(ms, r);
+		r.ticksPerSec = tickNs > 0 ? ms.size()*1e9/tickNs : 0;
+		r.counted = perfMain.active();
+		for(p=0;p<PERF_PHASES;p++)
+			for(k=0;k<PERF_COUNTERS;k++)
+				r.perFrame[p][k] = perfMain.has(k) && !ms.empty() ? (double)perfMain.total(p, k)/ms.size() : -1;
+		results.push_back(r);
+		fprintf(stderr, "%s done\n", b.name.c_str());
+		if(noAlloc && r.allocatingFrames){
+			fprintf(stderr, "%s: %ld of %ld frames allocated (%lld in the tick, %lld drawing, %lld in all)\n",
+					b.name.c_str(), r.allocatingFrames, r.frames, r.simAllocs, r.drawAllocs, r.frameAllocs);
+			failed++;
+		}
+	}
+	printBench(stdout, results);
+	if(!writeBenchJson(path, results, loaded ? load : NULL))
+		return 1;
+	return failed ? 1 : 0;
+}
 
-		eye2=glm::vec3(person.posx,person.posy,person.posz+0.5);
-		target2=glm::vec3(person.posx,person.posy,person.posz+2);
+int main (int argc, char** argv)
+{
+	int width = 600;
+	int height = 600;
+	ReplayHeader level;
+	const char *recordPath = NULL, *replayPath = NULL;
+	bool headless = false, solveOnly = false, validate = false;
+	unsigned int firstSeed = 0, lastSeed = 0;
+	const char *benchPath = NULL;
+	long benchFrames = 600;
+	bool framesGiven = false;
+	bool noAlloc = false;
+	Sweep sweep;
+	const char *problem;
+	const char *startupPath = NULL;
+	bool firstFrameOnly = false;
+	int threads = 0;
+	int a;
+
+	startup.begin();
+	defaultLevel(level);
+	for(a=1;a<argc;a++){
+		if(levelOption(argc, argv, a, level))
+			continue;
+		else if(!strcmp(argv[a],"--record") && a+1<argc)
+			recordPath = argv[++a];
+		else if(!strcmp(argv[a],"--replay") && a+1<argc)
+			replayPath = argv[++a];
+		else if(!strcmp(argv[a],"--headless"))
+			headless = true;
+		else if(!strcmp(argv[a],"--solve"))
+			solveOnly = true;
+		else if(!strcmp(argv[a],"--bot"))
+			useBot = true;
+		else if(!strcmp(argv[a],"--validate") && a+2<argc){
+			validate = true;
+			firstSeed = strtoul(argv[++a],NULL,10);
+			lastSeed = strtoul(argv[++a],NULL,10);
+		}
+		else if(!strcmp(argv[a],"--threads") && a+1<argc)
+			threads = atoi(argv[++a]);
+		else if(!strcmp(argv[a],"--profile") && a+1<argc)
+			profilePath = argv[++a];
+		else if(!strcmp(argv[a],"--gpu-times"))
+			gpuTimes = true;
+		else if(!strcmp(argv[a],"--stats") && a+1<argc)
+			statsPath = argv[++a];
+		else if(!strcmp(argv[a],"--bench") && a+1<argc)
+			benchPath = argv[++a];
+		else if(!strcmp(argv[a],"--frames") && a+1<argc){
+			benchFrames = atol(argv[++a]);
+			framesGiven = true;
+		}
+		else if(!strcmp(argv[a],"--perf"))
+			perfCounting = true;
+		else if(!strcmp(argv[a],"--no-alloc"))
+			noAlloc = true;
+		else if(!strcmp(argv[a],"--sweep") && a+2<argc && parseSweep(argv[a+1], argv[a+2], sweep))
+			a += 2;
+		else if(!strcmp(argv[a],"--startup") && a+1<argc)
+			startupPath = argv[++a];
+		else if(!strcmp(argv[a],"--first-frame"))
+			firstFrameOnly = true;
+		else if(!strcmp(argv[a],"--latency"))
+			latency.enable();
+		else{
+			fprintf(stderr, "usage: %s [--seed N] [--size W D] [--coins N] [--obstacles N] [--moving PCT] [--cans N] [--record FILE] [--replay FILE [--headless]] [--solve] [--bot] [--validate FIRST LAST] [--threads N] [--profile FILE] [--gpu-times] [--stats FILE] [--bench FILE [--frames N] [--no-alloc] [--sweep KNOB V1,V2,...]] [--perf] [--startup FILE] [--first-frame] [--latency]\n", argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+	profileThread("main");
+	if(profilePath)
+		profiling = true;
+	jobs = new JobSystem(threads);
+	startup.mark("job threads");
+	problem = checkLevel(level);
+	if(problem){
+		fprintf(stderr, "%s\n", problem);
+		exit(EXIT_FAILURE);
+	}
+	if((solveOnly || validate || useBot) && (long long)level.width*level.depth > SOLVER_MAX_CELLS){
+		fprintf(stderr, "--solve, --validate and --bot plan levels of up to %d cells\n", SOLVER_MAX_CELLS);
+		exit(EXIT_FAILURE);
+	}
+	if(!benchPath && (framesGiven || noAlloc || sweep.knob >= 0)){
+		fprintf(stderr, "--frames, --no-alloc and --sweep need --bench FILE\n");
+		exit(EXIT_FAILURE);
+	}
+	if(headless){
+		if(!replayPath){
+			fprintf(stderr, "--headless needs --replay FILE\n");
+			exit(EXIT_FAILURE);
+		}
+		int failed = replayHeadless(replayPath);
+		if(profilePath)
+			profileDump(profilePath);
+		exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	if(validate){
+		if(lastSeed < firstSeed){
+			fprintf(stderr, "--validate needs FIRST <= LAST\n");
+			exit(EXIT_FAILURE);
+		}
+		long lost = validateSeeds(level, firstSeed, lastSeed, *jobs);
+		if(profilePath)
+			profileDump(profilePath);
+		exit(lost ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	if(replayPath){
+		if(!replay.open(replayPath))
+			exit(EXIT_FAILURE);
+		level = replay.header;
+	}
+	world.generate(level.width, level.depth, level.coins, level.obstacles, level.seed, level.movingPercent, level.cans);
+	startup.mark("level");
+	if(solveOnly){
+		Solver solver;
+		SolveResult result;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		solver.solve(world, result);
+		printf("seed %u %dx%d: %s, %d/%d coins, score %d, %ld ticks, %ld nodes, %.3f ms\n", level.seed, level.width, level.depth,
+				result.winnable ? "winnable" : "not winnable", result.coins, world.totalCoins, result.score, result.ticks,
+				result.expanded, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+		exit(result.winnable ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	if(recordPath && !recorder.open(recordPath, level))
+		exit(EXIT_FAILURE);
 
-		eye3=glm::vec3(person.posx,person.posy+1,person.posz-1.5);
-		target3=glm::vec3(person.posx,person.posy,person.posz+2);
+	if(perfCounting && !perfMain.open())
+		fprintf(stderr, "perf_event_open failed: --perf has nothing to count\n");
+	GLFWwindow* window = initGLFW(width, height, benchPath != NULL || firstFrameOnly);
+	startup.mark("window");
+	perfMain.begin(PHASE_LOAD);
+	assets.open(PACK_FILE);
+	startup.mark("asset pack");
+	initGL (window, width, height);
+	assets.close();
+	perfMain.end();
+	startup.mark("gl state");
+	if(statsPath)
+		drawStats.openCsv(statsPath);
+	if(gpuTimes && !gpuTimers.init())
+		fprintf(stderr, "No timer queries: --gpu-times has nothing to measure\n");
+	if(benchPath){
+		vector<BenchScenario> scenarios;
+		if(sweep.knob >= 0)
+			sweepScenarios(level, sweep, scenarios);
+		else{
+			scenarios.assign(benchScenarios, benchScenarios + sizeof(benchScenarios)/sizeof(benchScenarios[0]));
+			for(size_t s=0;s<scenarios.size();s++)
+				scenarios[s].seed = level.seed;
+		}
+		int failed = runBench(window, benchPath, benchFrames, noAlloc, scenarios);
+		if(gpuTimes)
+			gpuTimers.report(stderr);
+		drawStats.closeCsv();
+		if(profilePath)
+			profileDump(profilePath);
+		gpuContextLost();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	frames.back().capture(world);
+	frames.publish();
+	simRunning = true;
+	simThread = thread(simulate);
+	startup.mark("sim start");
+	long framesTimed = 0;
+	long long frameStart = 0, now;
+	AllocCount frameAllocs = allocCount(), allocs;
+	while (!glfwWindowShouldClose(window)) {
+		PROFILE("frame");
+		latency.poll();
+		// close the last frame's counters, start to start
+		now = profileNow();
+		allocs = allocSince(frameAllocs);
+		frameAllocs = allocCount();
+		drawStats.add(STAT_ALLOCS, allocs.allocs);
+		drawStats.add(STAT_ALLOC_BYTES, allocs.bytes);
+		if(frameStart)
+			drawStats.frameDone((now - frameStart)/1e6);
+		frameStart = now;
+		const Frame &f = frames.latest();
+		latency.frameStart(f.lastInput);
+		perfMain.begin(PHASE_DRAW);
+		renderFrame(window, f);
+		perfMain.end();
+		latency.submitted();
+		if(gpuTimes && ++framesTimed % GPU_TIMER_WINDOW == 0)
+			gpuTimers.report(stderr);
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
-		if(person.lives==0){
-			cout << "Score: " << person.score << endl;
-			quit(window);
+		{
+			PROFILE("swap");
+			glfwSwapBuffers(window);
+		}
+		latency.swapped();
+		latency.poll();
+		if(!startup.finished()){
+			glFinish(); // on screen, not just queued
+			startup.firstFrame();
+			if(startupPath || firstFrameOnly)
+				startup.report(stderr);
+			if(startupPath)
+				startup.writeJson(startupPath);
+			if(firstFrameOnly)
+				quit(window);
+		}
+		{
+			PROFILE("poll events");
+			glfwPollEvents();
 		}
-		if(person.coins==6&&person.posx==9&&person.posz==9){
-			cout << "You won!!! Score: " << person.score << endl;
+		if(f.status==STATUS_LOST){
+			cout << "Score: " << f.score << endl;
 			quit(window);
 		}
-		current_time = glfwGetTime(); // Time in seconds
-		if ((current_time - last_update_time) >= 0.025) { // atleast 0.5s elapsed since last frame
-			last_update_time = current_time;
-			move_count++;
-			if(person.move1 && move_count%person.speed == 0)
-				person.move();
-			if(jump){
-				deltaTime+=0.025;
-				//cout << "time: " << deltaTime << endl;
-				person.t+=0.025;
-			}
-			if(move_count%240==0){
-				for(i=0;i<3;i++){
-					obstacle[i].posx = rand()%9 + 1;
-					obstacle[i].posy = 2;
-					obstacle[i].posz = rand()%9 + 1;
-					obstacle[i].speed = (((float)(rand()%50))/1000) + 0.04;
-					obstacle[i].dir = 1;
-				}
-			}
-			if(person.levitate){
-				timer.show=true;
-				counter++;
-				if(counter==320){
-					counter=0;
-					person.posy=2.5;
-					person.levitate=false;
-					timer.show=false;
-					timer.angle=0;
-				}
-			}
-			for(i=0;i<100;i++)
-				brick[i].index1 = (brick[i].index1 + 1)%16;	
-			brick[i].index2 = (brick[i].index2 + 1)%2;	
+		if(f.status==STATUS_WON){
+			cout << "You won!!! Score: " << f.score << endl;
+			quit(window);
 		}
+		if(simDone)
+			quit(window);
 	}
 
-	glfwTerminate();
-	exit(EXIT_SUCCESS);
+	quit(window);
 }
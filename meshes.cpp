@@ -0,0 +1,127 @@
+#include <cmath>
+
+#include "meshes.h"
+
+using namespace std;
+
+static const char *names[MODEL_COUNT] = {
+	"can", "straw", "bendy-straw", "umbrella", "obstacle",
+	"head", "coin", "clock", "heart-left", "heart-right"
+};
+
+const char *modelName(int model){
+	return names[model];
+}
+
+static void allocate(MeshData &m, unsigned int mode, int count){
+	m.mode = mode;
+	m.count = count;
+	m.storage.assign(6*count, 0.0f);
+	m.vertices = m.storage.data();
+	m.colors = m.storage.data() + 3*count;
+}
+
+static void paint(float *color, const float rgb[3]){
+	color[0] = rgb[0];
+	color[1] = rgb[1];
+	color[2] = rgb[2];
+}
+
+/* A fan of points one degree apart around (cx, cy) */
+static void circle(MeshData &m, int numVertices, double cx, double cy, float radius, const float rgb[3]){
+	allocate(m, PRIM_TRIANGLE_FAN, numVertices);
+	float *vertex_buffer_data = &m.storage[0];
+	float *color_buffer_data = &m.storage[3*numVertices];
+	for (int i=0; i<numVertices; i++) {
+		vertex_buffer_data [3*i] = cx + radius*cos(i*M_PI/180.0f);
+		vertex_buffer_data [3*i + 1] = cy + radius*sin(i*M_PI/180.0f);
+		vertex_buffer_data [3*i + 2] = 0;
+		paint(color_buffer_data + 3*i, rgb);
+	}
+}
+
+/* A strip of stacks bands, each going span radians round from -pi in
+   slices steps; the two edges of a band get colours a and b */
+static void sphere(MeshData &m, int slices, int stacks, double span, float radius, const float a[3], const float b[3]){
+	int n = 2 * (slices + 1) * stacks;
+	int i = 0;
+	allocate(m, PRIM_TRIANGLE_STRIP, n);
+	float *points = &m.storage[0];
+	float *color = &m.storage[3*n];
+	for (float theta = -M_PI / 2; theta < M_PI / 2 - 0.0001; theta += M_PI / stacks) {
+		for (float phi = -M_PI; phi <= -M_PI + span + 0.0001 && i < n; phi += span / slices) {
+
+			points[3*i] = radius*(cos(theta) * sin(phi));
+			points[3*i + 1] = radius*(-sin(theta));
+			points[3*i + 2] = radius*(cos(theta) * cos(phi));
+			paint(color + 3*i, a);
+
+			i++;
+
+			points[3*i] = radius*(cos(theta + M_PI / stacks) * sin(phi));
+			points[3*i + 1] = radius*(-sin(theta + M_PI / stacks));
+			points[3*i + 2] = radius*(cos(theta + M_PI / stacks) * cos(phi));
+			paint(color + 3*i, b);
+
+			i++;
+		}
+	}
+}
+
+/* 1500 rings of 360 points stacked height apart, the radius scaled by
+   factor and widening by grow per ring. Rings from rimFrom up take the
+   rim colour */
+static void tube(MeshData &m, float radius, float factor, double grow, float height, const float rgb[3], int rimFrom, const float rim[3]){
+	int numVertices = 360,i,j;
+	allocate(m, PRIM_TRIANGLE_FAN, 1500*numVertices);
+	float *vertex_buffer_data = &m.storage[0];
+	float *color_buffer_data = &m.storage[3*numVertices*1500];
+	for(j=0;j<1500;j++){
+		for (i=0; i<numVertices; i++) {
+			vertex_buffer_data [3*numVertices*j + 3*i] = factor*radius*cos(i*M_PI/180.0f);
+			vertex_buffer_data [3*numVertices*j + 3*i + 1] = height*j;
+			vertex_buffer_data [3*numVertices*j + 3*i + 2] = factor*radius*sin(i*M_PI/180.0f);
+			paint(color_buffer_data + 3*numVertices*j + 3*i, j >= rimFrom ? rim : rgb);
+		}
+		factor+=grow;
+	}
+}
+
+void buildModel(int model, MeshData &m){
+	static const float red[3] = {1,0,0}, grey[3] = {0.8,0.8,0.8};
+	static const float yellow[3] = {1,1,0}, white[3] = {1,1,1}, black[3] = {0,0,0};
+	static const float pink[3] = {1,0.2,0.6};
+	static const float canBody[3] = {0.01,0.13,0.4}, canRim[3] = {0,0.78,0.9};
+	switch(model){
+		case MODEL_CAN:
+			tube(m, 0.5, 0.7, 0.0003, 0.0007, canBody, 1493, canRim);
+			break;
+		case MODEL_STRAW:
+			tube(m, 0.5, 0.1, 0, 0.001, black, 1500, black);
+			break;
+		case MODEL_BENDY_STRAW:
+			tube(m, 0.5, 0.1, 0, 0.001, white, 1500, white);
+			break;
+		case MODEL_UMBRELLA:
+			sphere(m, 30, 30, M_PI, 0.5, pink, pink);
+			break;
+		case MODEL_OBSTACLE:
+			sphere(m, 30, 30, 2 * M_PI, 0.5, red, grey);
+			break;
+		case MODEL_HEAD:
+			sphere(m, 30, 30, 2 * M_PI, 0.375, yellow, yellow);
+			break;
+		case MODEL_COIN:
+			circle(m, 360, 0, 0, 0.2, yellow);
+			break;
+		case MODEL_CLOCK:
+			circle(m, 360, 0, 0, 0.5, white);
+			break;
+		case MODEL_HEART_LEFT:
+			circle(m, 190, -0.062, 0.125, 0.062, red);
+			break;
+		case MODEL_HEART_RIGHT:
+			circle(m, 190, 0.062, 0.125, 0.062, red);
+			break;
+	}
+}
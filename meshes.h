@@ -0,0 +1,41 @@
+#ifndef MESHES_H
+#define MESHES_H
+
+#include <vector>
+
+/* The generated meshes: circles, spheres and the stacked rings of the
+   can and its straws. They need no GL, so the same code builds them at
+   startup and in the asset baker. Vertices are xyz and colours rgb, one
+   triple per vertex. */
+
+enum Model {
+	MODEL_CAN,
+	MODEL_STRAW,
+	MODEL_BENDY_STRAW,
+	MODEL_UMBRELLA,
+	MODEL_OBSTACLE,
+	MODEL_HEAD,
+	MODEL_COIN,
+	MODEL_CLOCK,
+	MODEL_HEART_LEFT,
+	MODEL_HEART_RIGHT,
+	MODEL_COUNT
+};
+
+/* Same values as GL's primitive modes */
+#define PRIM_TRIANGLE_STRIP 5
+#define PRIM_TRIANGLE_FAN 6
+
+struct MeshData {
+	unsigned int mode;
+	int count;
+	const float *vertices;
+	const float *colors;
+	std::vector<float> storage;	// backs the arrays when built rather than mapped
+};
+
+/* Name the model is stored under in the asset pack */
+const char *modelName(int model);
+void buildModel(int model, MeshData &m);
+
+#endif
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "world.h"
+#include "stress.h"
+#include "profile.h"
+
+using namespace std;
+
+/* Simulation microbenchmarks: the tick and its systems on their own,
+   level generation and snapshots, all without a window.
+
+   usage: microbench [--runs N] [--baseline FILE] [--save FILE] [--threshold PCT] [--filter TEXT]
+                     [--size W D] [--coins N] [--obstacles N] [--moving PCT] [--cans N] [--sweep KNOB V1,V2,...]
+
+   Every case is set up once, run for a warm-up, then timed over N runs
+   (default 15) of a batch sized so one run takes about RUN_NS. The
+   median ns per operation of each case is compared against the
+   baseline, when one is given, and the program exits with status 1 if
+   any case got slower by more than the threshold (default 10%). --save
+   writes this run's medians as the next baseline.
+
+   With --sweep, the cases that scale with the level run instead on the
+   level the knobs describe, once for every value of the swept knob,
+   named after the point as in "step@obstacles-1000". The scenes are the
+   ones sample3D --bench draws for the same knobs. */
+
+#define RUN_NS 20000000LL	// 20 ms per timed run
+#define WARMUP_NS 100000000LL	// 100 ms before timing starts
+
+struct MicroState {
+	ReplayHeader level;	// for the level cases
+	World world;
+	Snapshot snap;
+	DeltaSnapshot delta;
+	unsigned int seed;
+};
+
+/* One benchmark: setup runs once, op once per timed operation */
+struct MicroCase {
+	const char *name;
+	void (*setup)(MicroState &s);
+	void (*op)(MicroState &s);
+};
+
+static void setupSmall(MicroState &s){
+	s.world.generate(10, 10, 6, 3, 1);
+}
+
+static void setupLarge(MicroState &s){
+	s.world.generate(40, 40, 6, 3, 1);
+}
+
+static void setupCrowded(MicroState &s){
+	s.world.generate(20, 20, 6, 40, 1);
+}
+
+static void setupSaved(MicroState &s){
+	s.world.generate(10, 10, 6, 3, 1);
+	s.world.save(s.snap);
+}
+
+/* A tick of the whole simulation, starting over when the level ends */
+static void opStep(MicroState &s){
+	if(s.world.status != STATUS_PLAYING)
+		s.world.rewind(s.snap);
+	s.world.step();
+}
+
+static void setupStep(MicroState &s){
+	setupSmall(s);
+	s.world.save(s.snap);
+}
+
+static void setupStepLarge(MicroState &s){
+	setupLarge(s);
+	s.world.save(s.snap);
+}
+
+/* Swept player against obstacle checks. The obstacles bounce and
+   respawn on their timers as in a real tick, and the player stands
+   where one of the obstacles is, so the checks hit as well as miss */
+static void opObstacles(MicroState &s){
+	World &w = s.world;
+	int e;
+	w.tick++;
+	w.timers.advance(w, w.tick);
+	w.moveBodies();
+	if(w.obstacleEnd > w.obstacleBegin){
+		e = w.obstacleBegin + (s.seed++ % (w.obstacleEnd - w.obstacleBegin));
+		w.transform.x[w.player] = w.pl.lastX = w.transform.x[e];
+		w.transform.y[w.player] = w.pl.lastY = 2.5;
+		w.transform.z[w.player] = w.pl.lastZ = w.transform.z[e];
+	}
+	w.checkObstacles();
+	w.pl.hitno = 0;
+}
+
+/* Coin pickup: put the player on a coin that is back in play */
+static void opCoins(MicroState &s){
+	World &w = s.world;
+	if(w.coinEnd == w.coinBegin)
+		return;
+	int c = w.coinBegin + (s.seed++ % (w.coinEnd - w.coinBegin));
+	w.pickup.active[c] = 1;
+	w.transform.x[w.player] = w.transform.x[c];
+	w.transform.z[w.player] = w.transform.z[c];
+	w.collectCoins();
+}
+
+/* One tick of a jump in the air, taking off again once it lands */
+static void opJump(MicroState &s){
+	World &w = s.world;
+	if(!w.pl.jump){
+		w.pl.jumpStart = -1;
+		w.pl.beforeht = w.transform.y[w.player];
+		w.startJump();
+	}
+	w.tick++;
+	w.leap();
+	w.pl.hitno = 0;
+}
+
+static void setupLevel(MicroState &s){
+	const ReplayHeader &l = s.level;
+	s.world.generate(l.width, l.depth, l.coins, l.obstacles, l.seed, l.movingPercent, l.cans);
+	s.world.save(s.snap);
+}
+
+static void opGenerateLevel(MicroState &s){
+	const ReplayHeader &l = s.level;
+	s.world.generate(l.width, l.depth, l.coins, l.obstacles, s.seed++, l.movingPercent, l.cans);
+}
+
+static void opGenerate(MicroState &s){
+	s.world.generate(10, 10, 6, 3, s.seed++);
+}
+
+static void opGenerateLarge(MicroState &s){
+	s.world.generate(40, 40, 6, 3, s.seed++);
+}
+
+static void opSave(MicroState &s){
+	s.world.save(s.snap);
+}
+
+static void opRestore(MicroState &s){
+	s.world.restore(s.snap);
+}
+
+/* A tick, then the pages it dirtied saved and put back */
+static void opDelta(MicroState &s){
+	if(s.world.status != STATUS_PLAYING)
+		s.world.rewind(s.snap);
+	s.world.step();
+	s.world.saveDelta(s.delta);
+	s.world.restoreDelta(s.delta, s.snap);
+}
+
+static const MicroCase cases[] = {
+	{ "step-10x10", setupStep, opStep },
+	{ "step-40x40", setupStepLarge, opStep },
+	{ "check-obstacles-40", setupCrowded, opObstacles },
+	{ "collect-coins", setupSmall, opCoins },
+	{ "jump", setupSmall, opJump },
+	{ "generate-10x10", setupSmall, opGenerate },
+	{ "generate-40x40", setupSmall, opGenerateLarge },
+	{ "snapshot-save", setupSaved, opSave },
+	{ "snapshot-restore", setupSaved, opRestore },
+	{ "snapshot-delta", setupSaved, opDelta },
+};
+
+/* The cases of a sweep, on the level at each point */
+static const MicroCase levelCases[] = {
+	{ "step", setupLevel, opStep },
+	{ "check-obstacles", setupLevel, opObstacles },
+	{ "collect-coins", setupLevel, opCoins },
+	{ "generate", setupLevel, opGenerateLevel },
+	{ "snapshot-save", setupLevel, opSave },
+	{ "snapshot-restore", setupLevel, opRestore },
+	{ "snapshot-delta", setupLevel, opDelta },
+};
+
+/* A case to run, on the level it runs on */
+struct MicroRun {
+	string name;
+	const MicroCase *c;
+	ReplayHeader level;
+};
+
+struct MicroResult {
+	double median, mean, stddev, min;	// ns per operation
+};
+
+/* Ops per run, doubling from one until a batch takes at least RUN_NS */
+static long calibrate(const MicroCase &c, MicroState &s){
+	long batch = 1, i;
+	long long start;
+	for(;;){
+		start = profileNow();
+		for(i=0;i<batch;i++)
+			c.op(s);
+		if(profileNow() - start >= RUN_NS || batch >= (1L<<30))
+			return batch;
+		batch *= 2;
+	}
+}
+
+static MicroResult measure(const MicroCase &c, int runs, const ReplayHeader &level){
+	MicroState s;	// fresh for every case
+	vector<double> ns;
+	MicroResult r;
+	long batch, i;
+	long long start;
+	int k;
+	s.level = level;
+	s.seed = 1;
+	c.setup(s);
+	start = profileNow();
+	while(profileNow() - start < WARMUP_NS)
+		c.op(s);
+	batch = calibrate(c, s);
+	for(k=0;k<runs;k++){
+		start = profileNow();
+		for(i=0;i<batch;i++)
+			c.op(s);
+		ns.push_back((double)(profileNow() - start)/batch);
+	}
+	sort(ns.begin(), ns.end());
+	r.min = ns[0];
+	r.median = runs % 2 ? ns[runs/2] : (ns[runs/2-1] + ns[runs/2])/2;
+	r.mean = 0;
+	for(k=0;k<runs;k++)
+		r.mean += ns[k];
+	r.mean /= runs;
+	r.stddev = 0;
+	for(k=0;k<runs;k++)
+		r.stddev += (ns[k] - r.mean)*(ns[k] - r.mean);
+	r.stddev = runs > 1 ? sqrt(r.stddev/(runs - 1)) : 0;
+	return r;
+}
+
+/* Baseline files hold one "name median-ns" line per case */
+static bool loadBaseline(const char *path, map<string, double> &baseline){
+	char name[128];
+	double ns;
+	FILE *fp = fopen(path, "r");
+	if(!fp)
+		return false;
+	while(fscanf(fp, "%127s %lf", name, &ns) == 2)
+		baseline[name] = ns;
+	fclose(fp);
+	return true;
+}
+
+int main(int argc, char **argv){
+	const char *baselinePath = NULL, *savePath = NULL, *filter = NULL;
+	map<string, double> baseline;
+	vector<pair<string, double> > medians;
+	vector<MicroRun> todo;
+	ReplayHeader level;
+	Sweep sweep;
+	const char *problem;
+	double threshold = 10;
+	int runs = 15, slower = 0, a;
+	size_t c, i;
+	FILE *out;
+
+	defaultLevel(level);
+	for(a=1;a<argc;a++){
+		if(levelOption(argc, argv, a, level))
+			continue;
+		else if(!strcmp(argv[a],"--runs") && a+1<argc)
+			runs = atoi(argv[++a]);
+		else if(!strcmp(argv[a],"--baseline") && a+1<argc)
+			baselinePath = argv[++a];
+		else if(!strcmp(argv[a],"--save") && a+1<argc)
+			savePath = argv[++a];
+		else if(!strcmp(argv[a],"--threshold") && a+1<argc)
+			threshold = atof(argv[++a]);
+		else if(!strcmp(argv[a],"--filter") && a+1<argc)
+			filter = argv[++a];
+		else if(!strcmp(argv[a],"--sweep") && a+2<argc && parseSweep(argv[a+1], argv[a+2], sweep))
+			a += 2;
+		else{
+			fprintf(stderr, "usage: %s [--runs N] [--baseline FILE] [--save FILE] [--threshold PCT] [--filter TEXT]"
+					" [--seed N] [--size W D] [--coins N] [--obstacles N] [--moving PCT] [--cans N] [--sweep KNOB V1,V2,...]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(sweep.knob < 0)
+		for(c=0;c<sizeof(cases)/sizeof(cases[0]);c++){
+			MicroRun run = { cases[c].name, &cases[c], level };
+			todo.push_back(run);
+		}
+	else
+		for(i=0;i<sweep.values.size();i++)
+			for(c=0;c<sizeof(levelCases)/sizeof(levelCases[0]);c++){
+				MicroRun run = { string(levelCases[c].name) + "@" + sweepName(sweep, i), &levelCases[c], sweepLevel(level, sweep, i) };
+				problem = checkLevel(run.level);
+				if(problem){
+					fprintf(stderr, "%s: %s\n", run.name.c_str(), problem);
+					return 2;
+				}
+				todo.push_back(run);
+			}
+	if(runs < 1)
+		runs = 1;
+	if(baselinePath && !loadBaseline(baselinePath, baseline))
+		fprintf(stderr, "No baseline in %s yet, nothing to compare\n", baselinePath);
+
+	printf("%-28s %12s %12s %10s %12s %10s\n", "case", "median ns", "mean ns", "stddev", "min ns", "vs base");
+	for(c=0;c<todo.size();c++){
+		const MicroRun &run = todo[c];
+		if(filter && !strstr(run.name.c_str(), filter))
+			continue;
+		MicroResult r = measure(*run.c, runs, run.level);
+		medians.push_back(make_pair(run.name, r.median));
+		printf("%-28s %12.1f %12.1f %9.1f%% %12.1f", run.name.c_str(), r.median, r.mean, r.mean > 0 ? 100*r.stddev/r.mean : 0.0, r.min);
+		if(baseline.count(run.name)){
+			double change = 100*(r.median/baseline[run.name] - 1);
+			printf(" %+9.1f%%", change);
+			if(change > threshold){
+				printf("  SLOWER");
+				slower++;
+			}
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if(savePath){
+		out = fopen(savePath, "w");
+		if(!out){
+			fprintf(stderr, "Cannot write %s\n", savePath);
+			return 2;
+		}
+		for(c=0;c<medians.size();c++)
+			fprintf(out, "%s %.1f\n", medians[c].first.c_str(), medians[c].second);
+		fclose(out);
+	}
+	if(slower)
+		fprintf(stderr, "%d case%s slower than the baseline by more than %.0f%%\n", slower, slower == 1 ? "" : "s", threshold);
+	return slower ? 1 : 0;
+}
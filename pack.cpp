@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pack.h"
+
+using namespace std;
+
+static unsigned long long alignUp(unsigned long long v){
+	return (v + PACK_ALIGN - 1) & ~(unsigned long long)(PACK_ALIGN - 1);
+}
+
+void PackWriter::add(const char *name, int kind, unsigned int p0, unsigned int p1, unsigned int p2, const void *data, size_t size){
+	PackEntry e;
+	memset(&e, 0, sizeof(e));
+	strncpy(e.name, name, sizeof(e.name) - 1);
+	e.kind = kind;
+	e.params[0] = p0;
+	e.params[1] = p1;
+	e.params[2] = p2;
+	e.size = size;
+	entries.push_back(e);
+	blobs.push_back(string((const char *)data, size));
+}
+
+bool PackWriter::write(const char *path){
+	PackHeader h;
+	unsigned long long at;
+	size_t i;
+	FILE *fp = fopen(path, "wb");
+	if(!fp){
+		fprintf(stderr, "Cannot write pack %s\n", path);
+		return false;
+	}
+	memcpy(h.magic, PACK_MAGIC, 4);
+	h.version = PACK_VERSION;
+	h.count = entries.size();
+	h.pad = 0;
+	at = alignUp(sizeof(h) + entries.size()*sizeof(PackEntry));
+	for(i=0;i<entries.size();i++){
+		entries[i].offset = at;
+		at = alignUp(at + entries[i].size);
+	}
+	fwrite(&h, sizeof(h), 1, fp);
+	if(!entries.empty())
+		fwrite(&entries[0], sizeof(PackEntry), entries.size(), fp);
+	for(i=0;i<entries.size();i++){
+		fseek(fp, entries[i].offset, SEEK_SET);
+		fwrite(blobs[i].data(), 1, blobs[i].size(), fp);
+	}
+	// the file runs to the aligned end of the last entry
+	fseek(fp, at - 1, SEEK_SET);
+	fputc(0, fp);
+	return fclose(fp) == 0;
+}
+
+Pack::Pack(){
+	base = NULL;
+	length = 0;
+	entries = NULL;
+	count = 0;
+}
+
+Pack::~Pack(){
+	close();
+}
+
+bool Pack::open(const char *path){
+	struct stat st;
+	const PackHeader *h;
+	unsigned int i;
+	int fd = ::open(path, O_RDONLY);
+	close();
+	if(fd < 0)
+		return false;
+	if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(PackHeader)){
+		::close(fd);
+		return false;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(base == MAP_FAILED){
+		base = NULL;
+		return false;
+	}
+	length = st.st_size;
+	h = (const PackHeader *)base;
+	if(memcmp(h->magic, PACK_MAGIC, 4) || h->version != PACK_VERSION
+			|| sizeof(PackHeader) + (unsigned long long)h->count*sizeof(PackEntry) > length){
+		fprintf(stderr, "%s is not a version %d asset pack\n", path, PACK_VERSION);
+		close();
+		return false;
+	}
+	entries = (const PackEntry *)(h + 1);
+	count = h->count;
+	for(i=0;i<count;i++)
+		if(entries[i].offset > length || entries[i].size > length - entries[i].offset){
+			fprintf(stderr, "%s is truncated\n", path);
+			close();
+			return false;
+		}
+	return true;
+}
+
+void Pack::close(){
+	if(base)
+		munmap(base, length);
+	base = NULL;
+	length = 0;
+	entries = NULL;
+	count = 0;
+}
+
+const PackEntry *Pack::find(const char *name, int kind){
+	unsigned int i;
+	for(i=0;i<count;i++)
+		if(entries[i].kind == (unsigned int)kind && !strncmp(entries[i].name, name, sizeof(entries[i].name)))
+			return &entries[i];
+	return NULL;
+}
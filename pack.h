@@ -0,0 +1,66 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Asset packs, written by the bake tool and memory-mapped by the game.
+   A header and a table of entries are followed by the entries' data,
+   each starting on a PACK_ALIGN boundary so it can be handed to GL
+   straight from the mapping. Textures hold their whole mipmap chain as
+   tightly packed RGB, largest level first; meshes hold count vertices
+   then count colours; shaders hold their source text. */
+
+#define PACK_MAGIC "MZPK"
+#define PACK_VERSION 1
+#define PACK_ALIGN 64
+#define PACK_FILE "assets.pack"
+
+enum PackKind { PACK_TEXTURE, PACK_MESH, PACK_SHADER };
+
+struct PackHeader {
+	char magic[4];
+	unsigned int version;
+	unsigned int count;
+	unsigned int pad;
+};
+
+struct PackEntry {
+	char name[48];
+	unsigned int kind;
+	unsigned int params[3];	// texture: width, height, levels; mesh: mode, count
+	unsigned long long offset;	// from the start of the file
+	unsigned long long size;
+};
+
+class PackWriter{
+	public:
+		void add(const char *name, int kind, unsigned int p0, unsigned int p1, unsigned int p2, const void *data, size_t size);
+		bool write(const char *path);
+
+	private:
+		std::vector<PackEntry> entries;
+		std::vector<std::string> blobs;
+};
+
+class Pack{
+	public:
+		Pack();
+		~Pack();
+		/* False, with the pack left empty, when the file is missing or
+		   not a pack this build can read */
+		bool open(const char *path);
+		void close();
+		bool active(){ return base != NULL; }
+		const PackEntry *find(const char *name, int kind);
+		const void *data(const PackEntry *e){ return (const char *)base + e->offset; }
+
+	private:
+		void *base;
+		size_t length;
+		const PackEntry *entries;
+		unsigned int count;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef PAGEMAP_H
+#define PAGEMAP_H
+
+#include <cstddef>
+#include <vector>
+
+/* Tracks which fixed-size pages of a block of memory have been written
+   since the last clear(). Writers call touch() for what they change; the
+   list of touched pages lets snapshot code copy only those. */
+
+#define PAGE_BITS 8
+#define PAGE_SIZE (1<<PAGE_BITS)
+
+struct PageMap {
+	const unsigned char *base;
+	size_t size;
+	std::vector<unsigned char> bits;
+	std::vector<int> list;
+
+	PageMap(){
+		base = NULL;
+		size = 0;
+	}
+
+	void reset(const unsigned char *b, size_t n){
+		base = b;
+		size = n;
+		bits.assign((n + PAGE_SIZE - 1) >> PAGE_BITS, 0);
+		list.clear();
+	}
+
+	void clear(){
+		size_t i;
+		for(i=0;i<list.size();i++)
+			bits[list[i]] = 0;
+		list.clear();
+	}
+
+	void touch(const void *p, size_t n){
+		size_t off, page, last;
+		if(!base || !n)
+			return;
+		off = (const unsigned char *)p - base;
+		last = (off + n - 1) >> PAGE_BITS;
+		for(page = off >> PAGE_BITS; page <= last; page++){
+			if(!bits[page]){
+				bits[page] = 1;
+				list.push_back(page);
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perfcount.h"
+
+const char *perfCounterNames[PERF_COUNTERS] = { "task_clock_ns", "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+const char *perfPhaseNames[PERF_PHASES] = { "sim", "draw", "load" };
+
+static const unsigned int counterTypes[PERF_COUNTERS] = {
+	PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+};
+
+static const unsigned long long counterConfigs[PERF_COUNTERS] = {
+	PERF_COUNT_SW_TASK_CLOCK,
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+	PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+PerfCounters::PerfCounters(){
+	int k;
+	for(k=0;k<PERF_COUNTERS;k++)
+		fd[k] = -1;
+	phase = -1;
+	reset();
+}
+
+PerfCounters::~PerfCounters(){
+	close();
+}
+
+bool PerfCounters::open(){
+	struct perf_event_attr attr;
+	int k;
+	close();
+	for(k=0;k<PERF_COUNTERS;k++){
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = counterTypes[k];
+		attr.config = counterConfigs[k];
+		attr.disabled = k == PERF_TASK_CLOCK;	// the group starts with its leader
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		// this thread, any CPU, in the leader's group
+		fd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, k == PERF_TASK_CLOCK ? -1 : fd[PERF_TASK_CLOCK], 0);
+		if(fd[k] >= 0 && ioctl(fd[k], PERF_EVENT_IOC_ID, &id[k]) < 0){
+			::close(fd[k]);
+			fd[k] = -1;
+		}
+		if(!active())
+			return false;
+	}
+	ioctl(fd[PERF_TASK_CLOCK], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(fd[PERF_TASK_CLOCK], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+void PerfCounters::close(){
+	int k;
+	// members first, the leader last
+	for(k=PERF_COUNTERS-1;k>=0;k--){
+		if(fd[k] >= 0)
+			::close(fd[k]);
+		fd[k] = -1;
+	}
+	phase = -1;
+}
+
+/* Every counter of the group from one read, scaled up for any time the
+   group was not on the CPU's counters */
+bool PerfCounters::read(long long *values){
+	unsigned long long buf[3 + 2*PERF_COUNTERS];
+	unsigned long long n, i;
+	double scale;
+	int k;
+	if(::read(fd[PERF_TASK_CLOCK], buf, sizeof(buf)) < (ssize_t)(3*sizeof(buf[0])))
+		return false;
+	n = buf[0];
+	scale = buf[2] ? (double)buf[1]/buf[2] : 1;
+	for(k=0;k<PERF_COUNTERS;k++)
+		values[k] = 0;
+	for(i=0;i<n && i<PERF_COUNTERS;i++)
+		for(k=0;k<PERF_COUNTERS;k++)
+			if(fd[k] >= 0 && id[k] == buf[4 + 2*i])
+				values[k] = (long long)(buf[3 + 2*i]*scale);
+	return true;
+}
+
+void PerfCounters::begin(int p){
+	if(!active() || phase >= 0)
+		return;
+	if(read(start))
+		phase = p;
+}
+
+void PerfCounters::end(){
+	long long now[PERF_COUNTERS];
+	int k;
+	if(phase < 0)
+		return;
+	if(read(now)){
+		for(k=0;k<PERF_COUNTERS;k++)
+			totals[phase][k] += now[k] - start[k];
+		count[phase]++;
+	}
+	phase = -1;
+}
+
+void PerfCounters::reset(){
+	int p, k;
+	for(p=0;p<PERF_PHASES;p++){
+		for(k=0;k<PERF_COUNTERS;k++)
+			totals[p][k] = 0;
+		count[p] = 0;
+	}
+}
+
+void PerfCounters::report(FILE *fp, const char *who) const {
+	int p, k;
+	for(p=0;p<PERF_PHASES;p++){
+		if(!count[p])
+			continue;
+		fprintf(fp, "%s %s, %ld calls:", who, perfPhaseNames[p], count[p]);
+		for(k=0;k<PERF_COUNTERS;k++)
+			if(has(k))
+				fprintf(fp, " %s %lld", perfCounterNames[k], totals[p][k]);
+			else
+				fprintf(fp, " %s -", perfCounterNames[k]);
+		if(has(PERF_CYCLES) && has(PERF_INSTRUCTIONS) && totals[p][PERF_CYCLES])
+			fprintf(fp, " (IPC %.2f)", (double)totals[p][PERF_INSTRUCTIONS]/totals[p][PERF_CYCLES]);
+		fprintf(fp, "\n");
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include <cstdio>
+
+/* Hardware counters of the calling thread through perf_event_open(2),
+   totalled per phase of a frame. The counters are opened as one group,
+   so every read is a single syscall and all of them cover the same
+   instructions. The task clock leads the group and is there even where
+   the CPU's counters are not (in most VMs); counters the kernel or CPU
+   does not offer are left out and reported as missing. Only user space
+   is counted, which perf_event_paranoid allows by default. */
+
+enum PerfCounter { PERF_TASK_CLOCK, PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_COUNTERS };
+
+enum PerfPhase { PHASE_SIM, PHASE_DRAW, PHASE_LOAD, PERF_PHASES };
+
+extern const char *perfCounterNames[PERF_COUNTERS];
+extern const char *perfPhaseNames[PERF_PHASES];
+
+class PerfCounters{
+	public:
+		PerfCounters();
+		~PerfCounters();
+		/* Open the counters for the calling thread, which is then the only
+		   one that may use the object; false if none could be opened */
+		bool open();
+		void close();
+		bool active() const { return fd[PERF_TASK_CLOCK] >= 0; }
+		bool has(int counter) const { return fd[counter] >= 0; }
+		/* Phases do not nest */
+		void begin(int phase);
+		void end();
+		void reset();
+		long long total(int phase, int counter) const { return totals[phase][counter]; }
+		long calls(int phase) const { return count[phase]; }
+		void report(FILE *fp, const char *who) const;
+
+	private:
+		int fd[PERF_COUNTERS];
+		unsigned long long id[PERF_COUNTERS];
+		long long start[PERF_COUNTERS];
+		long long totals[PERF_PHASES][PERF_COUNTERS];
+		long count[PERF_PHASES];
+		int phase;	// being counted, -1 for none
+		bool read(long long *values);
+		PerfCounters(const PerfCounters &);
+		PerfCounters &operator=(const PerfCounters &);
+};
+
+#endif
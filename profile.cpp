@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "profile.h"
+
+using namespace std;
+
+atomic<bool> profiling(false);
+
+/* One per thread that has recorded anything. The owner writes events
+   and then publishes the new head; readers only look below it. */
+struct ProfileBuffer {
+	int tid;
+	const char *name;
+	atomic<long> head;
+	ProfileEvent events[PROFILE_EVENTS];
+};
+
+static mutex buffersLock;	// held only to add a thread and to dump
+static vector<ProfileBuffer *> buffers;
+static thread_local ProfileBuffer *mine = NULL;
+static thread_local const char *myName = NULL;	// until the buffer exists
+
+static ProfileBuffer *threadBuffer(){
+	if(!mine){
+		mine = new ProfileBuffer;	// kept for the life of the process: a dump may still read it
+		mine->name = myName;
+		mine->head = 0;
+		lock_guard<mutex> hold(buffersLock);
+		mine->tid = buffers.size() + 1;
+		buffers.push_back(mine);
+	}
+	return mine;
+}
+
+/* Only names the thread: its buffer is made by the first event it
+   records, so threads cost nothing while profiling is off */
+void profileThread(const char *name){
+	myName = name;
+	if(mine)
+		mine->name = name;
+}
+
+void profileRecord(const char *name, long long start, long long end){
+	ProfileBuffer *b = threadBuffer();
+	long h = b->head.load(memory_order_relaxed);
+	ProfileEvent &e = b->events[h % PROFILE_EVENTS];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+	b->head.store(h + 1, memory_order_release);
+}
+
+long profileDump(const char *path){
+	vector<ProfileEvent> copy;
+	long written = 0, h, i, first;
+	size_t t;
+	FILE *fp = fopen(path, "w");
+	if(!fp){
+		fprintf(stderr, "Cannot write trace %s\n", path);
+		return -1;
+	}
+	lock_guard<mutex> hold(buffersLock);
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for(t=0;t<buffers.size();t++){
+		ProfileBuffer *b = buffers[t];
+		// copy first, oldest to newest; the owner keeps writing meanwhile and
+		// can only overwrite the oldest of a full ring
+		h = b->head.load(memory_order_acquire);
+		first = h > PROFILE_EVENTS ? h - PROFILE_EVENTS : 0;
+		copy.assign(b->events + first % PROFILE_EVENTS, b->events + (h > PROFILE_EVENTS ? PROFILE_EVENTS : h));
+		if(first % PROFILE_EVENTS)
+			copy.insert(copy.end(), b->events, b->events + first % PROFILE_EVENTS);
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				written || t ? ",\n" : "", b->tid, b->name ? b->name : "worker");
+		for(i=0;i<(long)copy.size();i++){
+			const ProfileEvent &e = copy[i];
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					e.name, b->tid, e.start/1000.0, (e.end - e.start)/1000.0);
+			written++;
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return written;
+}
@@ -0,0 +1,59 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <chrono>
+
+/* Scoped CPU timing. PROFILE("name") times the rest of the enclosing
+   block on the calling thread. Each thread appends to a ring of its own,
+   so recording takes no lock; profileDump() writes the most recent
+   PROFILE_EVENTS events of every thread as a Chrome trace_event file
+   for chrome://tracing or Perfetto. Names must be string literals.
+
+   While recording is off a scope costs one load and branch. Building
+   with -DPROFILE_OFF removes the scopes altogether. */
+
+#define PROFILE_EVENTS 65536	// per thread
+
+struct ProfileEvent {
+	const char *name;
+	long long start, end;	// ns on the steady clock
+};
+
+extern std::atomic<bool> profiling;
+
+/* Name the calling thread in the trace */
+void profileThread(const char *name);
+void profileRecord(const char *name, long long start, long long end);
+/* Write the trace to path; returns the number of events written */
+long profileDump(const char *path);
+
+inline long long profileNow(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class ProfileScope{
+	public:
+		ProfileScope(const char *n){
+			name = n;
+			start = profiling.load(std::memory_order_relaxed) ? profileNow() : -1;
+		}
+		~ProfileScope(){
+			if(start >= 0)
+				profileRecord(name, start, profileNow());
+		}
+
+	private:
+		const char *name;
+		long long start;
+};
+
+#ifdef PROFILE_OFF
+#define PROFILE(name)
+#else
+#define PROFILE_JOIN(a, b) a##b
+#define PROFILE_LINE(line) PROFILE_JOIN(profileScope, line)
+#define PROFILE(name) ProfileScope PROFILE_LINE(__LINE__)(name)
+#endif
+
+#endif
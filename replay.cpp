@@ -0,0 +1,163 @@
+#include <cstring>
+#include <chrono>
+
+#include "replay.h"
+#include "world.h"
+
+using namespace std;
+
+static void putVarint(FILE *fp, unsigned long v){
+	while(v >= 0x80){
+		fputc((int)(v & 0x7f) | 0x80, fp);
+		v >>= 7;
+	}
+	fputc((int)v, fp);
+}
+
+static bool getVarint(FILE *fp, unsigned long &v){
+	int c, shift = 0;
+	v = 0;
+	do{
+		if((c = fgetc(fp)) == EOF)
+			return false;
+		v |= (unsigned long)(c & 0x7f) << shift;
+		shift += 7;
+	}while(c & 0x80);
+	return true;
+}
+
+Recorder::Recorder(){
+	fp = NULL;
+	lastTick = 0;
+}
+
+bool Recorder::open(const char *path, const ReplayHeader &header){
+	fp = fopen(path, "wb");
+	if(!fp){
+		fprintf(stderr, "Cannot write recording %s\n", path);
+		return false;
+	}
+	fwrite(&header, sizeof(header), 1, fp);
+	lastTick = 0;
+	return true;
+}
+
+void Recorder::record(long tick, const InputEvent &ev){
+	if(!fp)
+		return;
+	putVarint(fp, tick - lastTick);
+	lastTick = tick;
+	fputc((ev.type << 6) | (ev.action << 5) | (ev.code & 0x1f), fp);
+	if(ev.type == INPUT_SCROLL || ev.type == INPUT_CURSOR){
+		fwrite(&ev.x, sizeof(float), 1, fp);
+		fwrite(&ev.y, sizeof(float), 1, fp);
+	}
+}
+
+void Recorder::close(long tick, unsigned int checksum){
+	if(!fp)
+		return;
+	putVarint(fp, tick - lastTick);
+	fputc(REPLAY_END, fp);
+	fwrite(&checksum, sizeof(checksum), 1, fp);
+	fclose(fp);
+	fp = NULL;
+}
+
+ReplayReader::ReplayReader(){
+	fp = NULL;
+	pending = false;
+	finished = false;
+	endTick = -1;
+	endChecksum = 0;
+}
+
+ReplayReader::~ReplayReader(){
+	if(fp)
+		fclose(fp);
+}
+
+bool ReplayReader::open(const char *path){
+	fp = fopen(path, "rb");
+	if(!fp){
+		fprintf(stderr, "Cannot read recording %s\n", path);
+		return false;
+	}
+	if(fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, REPLAY_MAGIC, 4) || header.version != REPLAY_VERSION){
+		fprintf(stderr, "%s is not a recording this build can play\n", path);
+		fclose(fp);
+		fp = NULL;
+		return false;
+	}
+	nextTick = 0;
+	readNext();
+	return true;
+}
+
+void ReplayReader::readNext(){
+	unsigned long delta;
+	int c;
+	pending = false;
+	if(finished || !getVarint(fp, delta) || (c = fgetc(fp)) == EOF){
+		finished = true;
+		return;
+	}
+	nextTick += delta;
+	if(c == REPLAY_END){
+		endTick = nextTick;
+		if(fread(&endChecksum, sizeof(endChecksum), 1, fp) != 1)
+			endTick = -1;
+		finished = true;
+		return;
+	}
+	next.time = 0;
+	next.type = c >> 6;
+	next.action = (c >> 5) & 1;
+	next.code = c & 0x1f;
+	next.x = next.y = 0;
+	if(next.type == INPUT_SCROLL || next.type == INPUT_CURSOR){
+		if(fread(&next.x, sizeof(float), 1, fp) != 1 || fread(&next.y, sizeof(float), 1, fp) != 1){
+			finished = true;
+			return;
+		}
+	}
+	pending = true;
+}
+
+void ReplayReader::feed(World &world){
+	while(pending && nextTick <= world.tick){
+		world.input(next);
+		readNext();
+	}
+}
+
+int replayHeadless(const char *path){
+	ReplayReader rp;
+	World world;
+	unsigned int sum;
+	if(!rp.open(path))
+		return 1;
+	world.generate(rp.header.width, rp.header.depth, rp.header.coins, rp.header.obstacles, rp.header.seed, rp.header.movingPercent, rp.header.cans);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	while(world.status == STATUS_PLAYING && (rp.endTick < 0 || world.tick < rp.endTick)){
+		rp.feed(world);
+		world.step();
+		if(rp.finished && rp.endTick < 0)
+			break;
+	}
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	sum = world.checksum();
+	printf("replay %s: %ld ticks in %.3f ms (%.0f ticks/s), score %d\n", path, world.tick, secs*1000, secs > 0 ? world.tick/secs : 0.0, world.pl.score);
+	if(rp.endTick < 0){
+		printf("recording has no end marker, nothing to verify\n");
+		return 1;
+	}
+	if(world.tick != rp.endTick || sum != rp.endChecksum){
+		printf("DIVERGED: expected tick %ld checksum %08x, got tick %ld checksum %08x\n", rp.endTick, rp.endChecksum, world.tick, sum);
+		return 1;
+	}
+	printf("matches recording (checksum %08x)\n", sum);
+	return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdio>
+
+#include "input.h"
+
+class World;
+
+/* Session recordings. A file holds the level parameters and seed, then one
+   record per input event stamped with the tick it was applied on, then an
+   end marker with the final tick and World::checksum(). Records are
+   variable length: a varint tick delta, one byte packing type, action and
+   code, and two floats only for scroll and cursor events. */
+
+#define REPLAY_MAGIC "MZRP"
+#define REPLAY_VERSION 5
+#define REPLAY_END 0xff
+
+struct ReplayHeader {
+	char magic[4];
+	unsigned int version;
+	unsigned int seed;
+	int width;
+	int depth;
+	int coins;
+	int obstacles;
+	int movingPercent;	// of the cells
+	int cans;
+};
+
+class Recorder{
+	public:
+		Recorder();
+		bool open(const char *path, const ReplayHeader &header);
+		void record(long tick, const InputEvent &ev);
+		void close(long tick, unsigned int checksum);
+		bool active(){ return fp != NULL; }
+
+	private:
+		FILE *fp;
+		long lastTick;
+};
+
+class ReplayReader{
+	public:
+		ReplayHeader header;
+		long endTick;
+		unsigned int endChecksum;
+		bool finished;
+
+		ReplayReader();
+		~ReplayReader();
+		bool open(const char *path);
+		bool active(){ return fp != NULL; }
+		/* Apply every recorded event due on the world's current tick */
+		void feed(World &world);
+
+	private:
+		FILE *fp;
+		bool pending;
+		long nextTick;
+		InputEvent next;
+		void readNext();
+};
+
+/* Run a recording to its end without a window; returns 0 when the final
+   state matches the recording */
+int replayHeadless(const char *path);
+
+#endif
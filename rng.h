@@ -0,0 +1,37 @@
+#ifndef RNG_H
+#define RNG_H
+
+/* PCG32 random number generator (O'Neill, pcg-random.org). Each gameplay
+   subsystem owns a stream so that drawing more numbers in one does not
+   shift the sequence seen by another. Plain data, copied with the world. */
+struct Rng {
+	unsigned long long state;
+	unsigned long long inc;
+
+	void seed(unsigned long long initstate, unsigned long long stream){
+		state = 0;
+		inc = (stream << 1) | 1;
+		next();
+		state += initstate;
+		next();
+	}
+
+	unsigned int next(){
+		unsigned long long old = state;
+		state = old * 6364136223846793005ULL + inc;
+		unsigned int xorshifted = ((old >> 18) ^ old) >> 27;
+		unsigned int rot = old >> 59;
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+	}
+
+	/* Integer in [0, n) */
+	int below(int n){
+		return (int)(((unsigned long long)next() * (unsigned int)n) >> 32);
+	}
+};
+
+/* Streams, one per subsystem */
+#define RNG_LEVEL 1
+#define RNG_OBSTACLE 2
+
+#endif
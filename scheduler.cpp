@@ -0,0 +1,146 @@
+#include "scheduler.h"
+
+using namespace std;
+
+TimerWheel::TimerWheel(){
+	node = NULL;
+	capacity = 0;
+	pages = NULL;
+	clear(0);
+}
+
+void TimerWheel::clear(long start){
+	int i;
+	now = start;
+	pending = 0;
+	used = 0;
+	freeHead = -1;
+	for(i=0;i<WHEEL_LEVELS*WHEEL_SLOTS;i++){
+		head[i] = -1;
+		tail[i] = -1;
+	}
+}
+
+void TimerWheel::attach(TimerNode *storage, int n){
+	node = storage;
+	capacity = n;
+}
+
+int TimerWheel::alloc(){
+	int id;
+	if(freeHead >= 0){
+		id = freeHead;
+		freeHead = node[id].next;
+		return id;
+	}
+	if(used >= capacity)
+		return -1;
+	return used++;
+}
+
+/* Put a timer in the slot matching its distance from now */
+void TimerWheel::link(int id){
+	TimerNode &t = node[id];
+	long delta = t.due - now;
+	long due = t.due;
+	int level, s;
+
+	if(delta < WHEEL_SLOTS)
+		level = 0;
+	else if(delta < 1L<<(2*WHEEL_BITS))
+		level = 1;
+	else if(delta < 1L<<(3*WHEEL_BITS))
+		level = 2;
+	else{
+		level = 3;
+		// beyond the horizon: park in the farthest slot, it is re-filed on cascade
+		if(delta >= 1L<<(4*WHEEL_BITS))
+			due = now + (1L<<(4*WHEEL_BITS)) - 1;
+	}
+	s = level*WHEEL_SLOTS + ((due >> (level*WHEEL_BITS)) & WHEEL_MASK);
+
+	t.slot = s;
+	t.next = -1;
+	t.prev = tail[s];
+	touch(id);
+	if(tail[s] >= 0){
+		node[tail[s]].next = id;
+		touch(tail[s]);
+	}
+	else
+		head[s] = id;
+	tail[s] = id;
+}
+
+void TimerWheel::unlink(int id){
+	TimerNode &t = node[id];
+	if(t.prev >= 0){
+		node[t.prev].next = t.next;
+		touch(t.prev);
+	}
+	else
+		head[t.slot] = t.next;
+	if(t.next >= 0){
+		node[t.next].prev = t.prev;
+		touch(t.next);
+	}
+	else
+		tail[t.slot] = t.prev;
+	t.slot = -1;
+	touch(id);
+}
+
+int TimerWheel::schedule(long due, TimerFunc fn, int arg){
+	int id = alloc();
+	if(id < 0)
+		return -1;
+	TimerNode &t = node[id];
+	t.due = due > now ? due : now + 1;
+	t.fn = fn;
+	t.arg = arg;
+	link(id);
+	pending++;
+	return id;
+}
+
+void TimerWheel::cancel(int id){
+	if(id < 0 || id >= used || node[id].slot < 0)
+		return;
+	unlink(id);
+	node[id].next = freeHead;
+	freeHead = id;
+	pending--;
+}
+
+/* Re-file every timer of a higher-level slot; they all land lower down */
+void TimerWheel::cascade(int level, int index){
+	int s = level*WHEEL_SLOTS + index;
+	int id = head[s];
+	head[s] = -1;
+	tail[s] = -1;
+	while(id >= 0){
+		int next = node[id].next;
+		link(id);
+		id = next;
+	}
+}
+
+void TimerWheel::advance(World &world, long to){
+	while(now < to){
+		int level, s, id;
+		now++;
+		for(level=1;level<WHEEL_LEVELS;level++){
+			if((now >> ((level-1)*WHEEL_BITS)) & WHEEL_MASK)
+				break;
+			cascade(level, (now >> (level*WHEEL_BITS)) & WHEEL_MASK);
+		}
+
+		// pop one at a time so callbacks may cancel or schedule freely
+		s = now & WHEEL_MASK;
+		while((id = head[s]) >= 0){
+			TimerNode t = node[id];
+			cancel(id);
+			t.fn(world, t.arg);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "pagemap.h"
+
+/* Hierarchical timer wheel for gameplay events. Timers are kept in four
+   levels of 64 slots; level n covers deltas up to 64^(n+1) ticks. Insert
+   and cancel are O(1), and advancing one tick only touches the slot due at
+   that tick, plus one higher-level slot every 64 ticks which is cascaded
+   down. Nothing scans the full set of pending timers.
+
+   The wheel holds no heap memory of its own: nodes live in storage the
+   owner attaches, so the whole wheel can be copied as plain data. */
+
+class World;
+
+typedef void (*TimerFunc)(World &world, int arg);
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1<<WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS-1)
+#define WHEEL_LEVELS 4
+
+struct TimerNode {
+	long due;
+	TimerFunc fn;
+	int arg;
+	int prev;
+	int next;
+	int slot;	// level*WHEEL_SLOTS + index, -1 while on the free list
+};
+
+class TimerWheel{
+	public:
+		long now;
+		int pending;
+		TimerNode *node;
+		int capacity;
+		int used;
+		int freeHead;
+		PageMap *pages;	// told about every node written, may be NULL
+		int head[WHEEL_LEVELS*WHEEL_SLOTS];
+		int tail[WHEEL_LEVELS*WHEEL_SLOTS];
+
+		TimerWheel();
+		void clear(long start);
+		/* Node storage; when growing, the old nodes must already be copied in */
+		void attach(TimerNode *storage, int capacity);
+		bool full(){ return freeHead < 0 && used >= capacity; }
+
+		/* Call fn(world, arg) once the wheel reaches tick due (the next tick
+		   if due is not in the future). The returned handle stays valid until
+		   the timer fires or is cancelled; -1 when the storage is full. */
+		int schedule(long due, TimerFunc fn, int arg);
+		void cancel(int id);
+
+		/* Step forward to tick to, firing timers in due order. Timers due on
+		   the same tick fire in an order fixed by the sequence of schedule
+		   and cancel calls, so a replay fires them alike; it is not always
+		   the order they were scheduled in, as a cascade refiles a slot's
+		   timers behind those already in the lower slot */
+		void advance(World &world, long to);
+
+	private:
+		int alloc();
+		void link(int id);
+		void unlink(int id);
+		void cascade(int level, int index);
+		void touch(int id){ if(pages) pages->touch(&node[id], sizeof(TimerNode)); }
+};
+
+#endif
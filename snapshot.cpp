@@ -0,0 +1,74 @@
+#include <cstring>
+
+#include "world.h"
+
+using namespace std;
+
+/* Snapshots of the world. The header is always copied whole; the arena is
+   copied whole by save() and restore(), and page by page by the delta
+   functions, which lean on the pages the world marks as it writes. */
+
+void World::save(Snapshot &snap){
+	snap.state = *this;
+	snap.arena.resize(size);
+	memcpy(&snap.arena[0], mem, size);
+	dirty.clear();
+}
+
+void World::restore(const Snapshot &snap){
+	if(snap.arena.size() != size)
+		allocate(snap.arena.size());
+	static_cast<WorldState &>(*this) = snap.state;
+	memcpy(mem, &snap.arena[0], size);
+	bind();
+	dirty.clear();
+}
+
+void World::saveDelta(DeltaSnapshot &delta){
+	size_t i, off, n = dirty.list.size();
+	delta.state = *this;
+	delta.arenaSize = size;
+	delta.pages.assign(dirty.list.begin(), dirty.list.end());
+	delta.data.resize(n*PAGE_SIZE);
+	for(i=0;i<n;i++){
+		off = (size_t)dirty.list[i] << PAGE_BITS;
+		memcpy(&delta.data[i*PAGE_SIZE], mem + off, min((size_t)PAGE_SIZE, size - off));
+	}
+}
+
+/* Copy back from the base every page written since it was taken */
+void World::revert(const Snapshot &base){
+	size_t i, off;
+	for(i=0;i<dirty.list.size();i++){
+		off = (size_t)dirty.list[i] << PAGE_BITS;
+		memcpy(mem + off, &base.arena[off], min((size_t)PAGE_SIZE, size - off));
+	}
+	dirty.clear();
+}
+
+void World::restoreDelta(const DeltaSnapshot &delta, const Snapshot &base){
+	size_t i, off;
+	if(size == base.arena.size() && delta.arenaSize == size)
+		revert(base);
+	else if(delta.arenaSize == base.arena.size())
+		restore(base);
+	else
+		allocate(delta.arenaSize);	// grown after the base: the delta holds every page
+	for(i=0;i<delta.pages.size();i++){
+		off = (size_t)delta.pages[i] << PAGE_BITS;
+		memcpy(mem + off, &delta.data[i*PAGE_SIZE], min((size_t)PAGE_SIZE, size - off));
+		dirty.touch(mem + off, 1);
+	}
+	static_cast<WorldState &>(*this) = delta.state;
+	bind();
+}
+
+void World::rewind(const Snapshot &base){
+	if(size != base.arena.size()){
+		restore(base);
+		return;
+	}
+	revert(base);
+	static_cast<WorldState &>(*this) = base.state;
+	bind();
+}
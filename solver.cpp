@@ -0,0 +1,643 @@
+#include <cmath>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+
+#include "solver.h"
+#include "sweep.h"
+
+using namespace std;
+
+static const int stepX[5] = { 0, 1, 0, -1, 0 };
+static const int stepZ[5] = { 0, 0, -1, 0, 1 };
+
+Solver::Solver(){
+	width = depth = 0;
+	start = 0;
+	solid = NULL;
+	playerRadius = 0;
+	canCell = -1;
+	canActive = false;
+	levY = 4.5;
+	tracked = 0;
+}
+
+/* Copy what the search needs out of the world: the grid, moving brick and
+   obstacle motion, and the can */
+void Solver::load(World &world){
+	int c, e, cells;
+	size_t words;
+	width = world.width;
+	depth = world.depth;
+	cells = width*depth;
+	start = world.tick;
+	solid = world.solid;
+	playerRadius = world.collider.radius[world.player];
+
+	moverOf.assign(cells, -1);
+	movers.clear();
+	for(c=0;c<cells;c++){
+		if(!world.moving[c])
+			continue;
+		e = world.cell[c];
+		Mover m;
+		m.y = world.transform.y[e];
+		m.vy = world.motion.vy[e];
+		m.lo = world.motion.lo[e];
+		m.hi = world.motion.hi[e];
+		m.turn = world.motion.timer[e] >= 0 ? world.timers.node[world.motion.timer[e]].due : LONG_MAX;
+		moverOf[c] = movers.size();
+		movers.push_back(m);
+	}
+
+	canCell = -1;
+	canActive = false;
+	levY = world.pl.levitate ? world.transform.y[world.player] : 4.5;
+	rng = world.obstacleRng;
+	bodies.clear();
+	for(e=world.canBegin;e<world.canEnd;e++){
+		canCell = world.cellAt(world.transform.x[e], world.transform.z[e]);
+		canActive = world.pickup.active[e] && canCell >= 0;
+		// taken on a moving brick, the player drops back to the height it
+		// boarded at once the brick moves on (World::checkBelowMoving)
+		if(canActive && world.moving[canCell])
+			levY = 2.5;
+	}
+	for(e=world.obstacleBegin;e<world.obstacleEnd;e++){
+		Body b;
+		b.x = world.transform.x[e];
+		b.y = world.transform.y[e];
+		b.z = world.transform.z[e];
+		b.vy = world.motion.vy[e];
+		b.lo = world.motion.lo[e];
+		b.hi = world.motion.hi[e];
+		b.radius = world.collider.radius[e];
+		b.turn = world.motion.timer[e] >= 0 ? world.timers.node[world.motion.timer[e]].due : LONG_MAX;
+		bodies.push_back(b);
+	}
+	track.clear();
+	tracked = start;
+
+	buildArc();
+
+	words = ((size_t)cells*SOLVER_PHASES*3 + 31)/32;
+	if(closed.size() != words){
+		closed.assign(words, 0);
+		closedUsed.clear();
+	}
+}
+
+/* Samples the closed-form jump from a standing start: along is the
+   distance covered from the first walked cell, height the height after
+   each tick, up to the landing */
+void Solver::buildArc(){
+	int k;
+	arc.ticks = jumpTicks();
+	arc.along.resize(arc.ticks + 1);
+	arc.height.resize(arc.ticks + 1);
+	for(k=0;k<=arc.ticks;k++){
+		arc.along[k] = jumpRun(jumpTime(k));
+		arc.height[k] = 2.5 + jumpHeight(jumpTime(k));
+	}
+	arc.low.clear();
+	for(k=0;k<arc.ticks;k++)
+		if(arc.height[k] <= 2.5)
+			arc.low.push_back(k);
+}
+
+/* Cell a jump lands on when launched from c1, the cell its walk reaches,
+   or -1 when it would fall or leave the grid. Jumps that clear no pit are
+   dropped too: walking gets there sooner. */
+int Solver::landing(int c1, int d){
+	int x1 = c1%width, z1 = c1/width, x2, z2, x, z;
+	size_t i;
+	float far = arc.along[arc.ticks-1], a;
+	bool clears = false;
+	if(!solid[c1])
+		return -1;
+	// letting go snaps the player to the grid, truncating like World::endJump
+	x2 = (int)(x1 + stepX[d]*arc.along[arc.ticks]);
+	z2 = (int)(z1 + stepZ[d]*arc.along[arc.ticks]);
+	if(x2 < 0 || x2 >= width || z2 < 0 || z2 >= depth)
+		return -1;
+	for(x=x1+stepX[d],z=z1+stepZ[d];(x!=x2 || z!=z2) && !clears;x+=stepX[d],z+=stepZ[d])
+		clears = !solid[z*width + x];
+	if(!clears)
+		return -1;
+	// World::checkBoundary sees every position up to the last one in the air
+	if(x1 + stepX[d]*far < 0 || x1 + stepX[d]*far > width-1 || z1 + stepZ[d]*far < 0 || z1 + stepZ[d]*far > depth-1)
+		return -1;
+	// World::checkBelow at the points where the arc is not above the floor
+	for(i=0;i<arc.low.size();i++){
+		a = arc.along[arc.low[i]];
+		x = (int)floor(x1 + stepX[d]*a + 0.0001f);
+		z = (int)floor(z1 + stepZ[d]*a + 0.0001f);
+		if(!solid[z*width + x])
+			return -1;
+	}
+	return z2*width + x2;
+}
+
+/* Breadth-first flood over walks and jumps from the cells already queued.
+   With a budget, pits are open but only that many steps out. */
+void Solver::flood(vector<int> &queue, int budget){
+	vector<int> dist;
+	size_t head;
+	int c, d, x, z, n;
+	if(budget >= 0){
+		dist.assign(width*depth, -1);
+		for(head=0;head<queue.size();head++)
+			dist[queue[head]] = 0;
+	}
+	for(head=0;head<queue.size();head++){
+		c = queue[head];
+		x = c%width;
+		z = c/width;
+		if(budget >= 0 && dist[c] >= budget)
+			continue;
+		for(d=DIR_POSX;d<=DIR_POSZ;d++){
+			if(x + stepX[d] < 0 || x + stepX[d] >= width || z + stepZ[d] < 0 || z + stepZ[d] >= depth)
+				continue;
+			n = c + stepX[d] + stepZ[d]*width;
+			if(budget >= 0){
+				if(dist[n] < 0){
+					dist[n] = dist[c] + 1;
+					reach[n] = 1;
+					queue.push_back(n);
+				}
+				continue;
+			}
+			if(!reach[n] && solid[n]){
+				reach[n] = 1;
+				queue.push_back(n);
+			}
+			if(moverOf[c] >= 0 || moverOf[n] >= 0)
+				continue;
+			n = landing(n, d);
+			if(n >= 0 && !reach[n] && solid[n]){
+				reach[n] = 1;
+				queue.push_back(n);
+			}
+		}
+	}
+}
+
+/* Cells the player could still get to from cell from at tick t, ignoring
+   obstacles: pits are open only for as long as levitation can last */
+void Solver::mark(int from, int t, int levEnd){
+	vector<int> queue, ground;
+	size_t i;
+	bool floats = levY > 2.5;
+	reach.assign(width*depth, 0);
+	reach[from] = 1;
+	queue.push_back(from);
+	if(floats && levEnd > t)
+		flood(queue, levEnd - t);
+	else{
+		flood(queue, -1);
+		if(!floats || !canActive || levEnd != 0 || !reach[canCell])
+			return;
+		queue.assign(1, canCell);
+		flood(queue, LEVITATE_TICKS);
+	}
+	// walk on from wherever the levitation can end
+	for(i=0;i<queue.size();i++)
+		if(solid[queue[i]])
+			ground.push_back(queue[i]);
+	flood(ground, -1);
+}
+
+/* Height of the moving brick on cell c after tick t, following the same
+   reversal rule the world arms its timers with */
+float Solver::brickY(int c, long t){
+	const Mover &m = movers[moverOf[c]];
+	float y = m.y, v = m.vy;
+	long at = start, turn = m.turn;
+	while(turn <= t){
+		y += v*(turn - 1 - at);
+		v = -v;
+		at = turn;
+		turn += reversalDelay(y, v, m.lo, m.hi);
+		y += v;
+	}
+	return y + v*(t - at);
+}
+
+/* Obstacle positions after tick t, predicted forward as far as needed */
+const float *Solver::obstaclesAt(long t){
+	size_t i, n = bodies.size();
+	if(!n || (size_t)(t - start)*n*5 > SOLVER_MAX_TRACK)
+		return NULL;
+	while(tracked < t){
+		tracked++;
+		for(i=0;i<n;i++){
+			Body &b = bodies[i];
+			// respawns are scheduled every RESPAWN_TICKS from tick 0, in entity order
+			if(tracked % RESPAWN_TICKS == 0){
+				b.x = rng.below(width-1) + 1;
+				b.y = 2;
+				b.z = rng.below(depth-1) + 1;
+				b.vy = obstacleSpeed(rng);
+				b.turn = tracked + reversalDelay(b.y, b.vy, b.lo, b.hi);
+			}
+			else if(tracked == b.turn){
+				b.vy = -b.vy;
+				b.turn = tracked + reversalDelay(b.y, b.vy, b.lo, b.hi);
+			}
+			b.y += b.vy;
+			track.push_back(b.x);
+			track.push_back(b.y);
+			track.push_back(b.z);
+			track.push_back(b.radius);
+			track.push_back(b.vy);
+		}
+	}
+	return &track[(t - start - 1)*n*5];
+}
+
+/* Same swept test as World::checkObstacles, for the player moving from
+   p0 to p1 over tick t */
+bool Solver::hit(const float p0[3], const float p1[3], long t){
+	size_t i, n = bodies.size();
+	const float *o = obstaclesAt(t);
+	if(n && !o)
+		return true;	// past the predicted window
+	for(i=0;i<n;i++,o+=5){
+		float o0[3] = { o[0], o[1] - o[4], o[2] };
+		if(sweepSpheres(p0, p1, o0, o, playerRadius + o[3]) >= 0)
+			return true;
+	}
+	return false;
+}
+
+float Solver::standY(int c, int t, bool lev){
+	if(lev)
+		return levY;
+	if(moverOf[c] >= 0)
+		return brickY(c, start + t) + 2.5;
+	return 2.5;
+}
+
+/* Where the player standing on cell c is once tick t is done */
+void Solver::place(int c, int t, bool lev, float p[3]){
+	p[0] = c%width;
+	p[1] = standY(c, t, lev);
+	p[2] = c/width;
+}
+
+/* The checks of one World::step for a player coming from p (where the
+   last tick left it) to stand on cell c at tick t; picks up the can on
+   the way. False if the player would fall or be hit. */
+bool Solver::arrive(const float p[3], int c, int t, int &levEnd){
+	bool lev = levEnd > t;
+	float to[3];
+	if(!solid[c] && !(lev && levY > 2.5))
+		return false;
+	if(canActive && levEnd == 0 && c == canCell){
+		// World::checkCan puts the player up there, nothing is swept
+		levEnd = t + LEVITATE_TICKS;
+		place(c, t, true, to);
+		to[1] = 4.5;
+		return !hit(to, to, start + t);
+	}
+	place(c, t, lev, to);
+	return !hit(p, to, start + t);
+}
+
+static int distance(int a, int b, int width){
+	return abs(a%width - b%width) + abs(a/width - b/width);
+}
+
+static int canState(int levEnd, int t){
+	return levEnd == 0 ? 0 : levEnd > t ? 1 : 2;
+}
+
+static size_t closedKey(int cell, int t, int levEnd){
+	return ((size_t)cell*SOLVER_PHASES + t%SOLVER_PHASES)*3 + canState(levEnd, t);
+}
+
+/* True if arriving as m can only lead to a closed state: it is closed
+   already and arrive() will not pick up the can. Saves the hit tests. */
+bool Solver::seen(const Node &m){
+	size_t key = closedKey(m.cell, m.t, m.levEnd);
+	if(canActive && m.levEnd == 0 && m.cell == canCell)
+		return false;
+	return (closed[key >> 5] >> (key & 31)) & 1;
+}
+
+/* Mark the node's (cell, phase, can state) closed; false if it already was */
+bool Solver::close(const Node &n){
+	size_t key = closedKey(n.cell, n.t, n.levEnd);
+	unsigned int bit = 1u << (key & 31);
+	if(closed[key >> 5] & bit)
+		return false;
+	if(!closed[key >> 5])
+		closedUsed.push_back(key >> 5);
+	closed[key >> 5] |= bit;
+	return true;
+}
+
+int Solver::push(const Node &n, int target){
+	Open o;
+	size_t key = closedKey(n.cell, n.t, n.levEnd);
+	int h;
+	if(closed[key >> 5] & (1u << (key & 31)))
+		return -1;
+	o.g = n.t;
+	h = distance(n.cell, target, width);
+	// a pit is only reached afloat: by way of the can, and before it wears off
+	if(!solid[target]){
+		if(n.levEnd == 0)
+			h = distance(n.cell, canCell, width) + distance(canCell, target, width);
+		else if(n.levEnd < n.t + h)
+			return -1;
+	}
+	o.f = n.t + h;
+	o.node = nodes.size();
+	nodes.push_back(n);
+	open.push_back(o);
+	push_heap(open.begin(), open.end());
+	return o.node;
+}
+
+/* A* from cell from at tick t to target; returns the node standing on
+   target, or -1 */
+int Solver::search(int from, int t, int levEnd, int target, long &expanded){
+	size_t i;
+	int d, k;
+	for(i=0;i<closedUsed.size();i++)
+		closed[closedUsed[i]] = 0;
+	closedUsed.clear();
+	nodes.clear();
+	open.clear();
+
+	Node s;
+	s.cell = from;
+	s.t = t;
+	s.levEnd = levEnd;
+	s.parent = -1;
+	s.action = -1;
+	s.dir = DIR_NONE;
+	push(s, target);
+
+	while(!open.empty()){
+		pop_heap(open.begin(), open.end());
+		int id = open.back().node;
+		open.pop_back();
+		Node n = nodes[id];
+		if(n.cell == target)
+			return id;
+		if(!close(n))
+			continue;
+		expanded++;
+		if(n.t - t > SOLVER_HORIZON || nodes.size() > SOLVER_MAX_NODES)
+			return -1;
+		bool lev = levitating(n, n.t);
+		int x = n.cell%width, z = n.cell/width;
+		float here[3], p0[3], p1[3];
+		place(n.cell, n.t, lev, here);
+
+		Node m = n;
+		m.parent = id;
+		m.t = n.t + 1;
+		m.action = -1;
+		if(!seen(m) && arrive(here, n.cell, m.t, m.levEnd))
+			push(m, target);
+
+		// World::walk refuses to step off a moving brick below its rest height
+		if(moverOf[n.cell] >= 0 && !lev && brickY(n.cell, start + n.t) < 0)
+			continue;
+
+		for(d=DIR_POSX;d<=DIR_POSZ;d++){
+			int x1 = x + stepX[d], z1 = z + stepZ[d];
+			if(x1 < 0 || x1 >= width || z1 < 0 || z1 >= depth)
+				continue;
+			int c1 = z1*width + x1;
+
+			m = n;
+			m.parent = id;
+			m.cell = c1;
+			m.t = n.t + 1;
+			m.action = ACT_WALK;
+			m.dir = d;
+			if(!seen(m) && arrive(here, c1, m.t, m.levEnd))
+				push(m, target);
+
+			// a jump walks onto c1 and leaps on from there; keep to plain ground
+			if(lev || moverOf[n.cell] >= 0 || moverOf[c1] >= 0 || (canActive && n.levEnd == 0 && c1 == canCell))
+				continue;
+			int c2 = landing(c1, d);
+			if(c2 < 0)
+				continue;
+			m = n;
+			m.parent = id;
+			m.cell = c2;
+			m.t = n.t + arc.ticks + 1;
+			m.action = ACT_JUMP;
+			m.dir = d;
+			if(seen(m))
+				continue;
+			// in the air: from where the walk started, then along the arc
+			bool ok = true;
+			p1[0] = here[0];
+			p1[1] = here[1];
+			p1[2] = here[2];
+			for(k=1;k<=arc.ticks && ok;k++){
+				float a = arc.along[k-1];
+				p0[0] = p1[0];
+				p0[1] = p1[1];
+				p0[2] = p1[2];
+				p1[0] = x1 + stepX[d]*a;
+				p1[1] = arc.height[k-1];
+				p1[2] = z1 + stepZ[d]*a;
+				ok = !hit(p0, p1, start + n.t + k);
+			}
+			if(!ok)
+				continue;
+			// letting go snaps the player onto c2 at the takeoff height
+			p0[0] = c2%width;
+			p0[1] = 2.5;
+			p0[2] = c2/width;
+			if(arrive(p0, m.cell, m.t, m.levEnd))
+				push(m, target);
+		}
+	}
+	return -1;
+}
+
+/* Drop the coins on cell c, adding them to the result */
+static void collect(vector<int> &coinCell, vector<int> &coinValue, int c, SolveResult &out){
+	size_t i = 0;
+	while(i < coinCell.size()){
+		if(coinCell[i] != c){
+			i++;
+			continue;
+		}
+		out.coins++;
+		out.score += coinValue[i];
+		coinCell.erase(coinCell.begin() + i);
+		coinValue.erase(coinValue.begin() + i);
+	}
+}
+
+bool Solver::solve(World &world, SolveResult &out){
+	int p = world.player, goal, e, i, cur, t, levEnd, target, best, node;
+	size_t first;
+	vector<int> coinCell, coinValue;
+	bool reached = true;
+
+	out.winnable = false;
+	out.coins = 0;
+	out.score = world.pl.score;
+	out.ticks = 0;
+	out.expanded = 0;
+	out.plan.clear();
+	if(world.pl.jump || world.transform.x[p] != floor(world.transform.x[p]) || world.transform.z[p] != floor(world.transform.z[p]))
+		return false;
+	if((long long)world.width*world.depth > SOLVER_MAX_CELLS)
+		return false;
+	cur = world.cellAt(world.transform.x[p], world.transform.z[p]);
+	if(cur < 0)
+		return false;
+	load(world);
+	goal = width*depth - 1;
+
+	for(e=world.coinBegin;e<world.coinEnd;e++){
+		if(!world.pickup.active[e])
+			continue;
+		coinCell.push_back(world.cellAt(world.transform.x[e], world.transform.z[e]));
+		coinValue.push_back(world.pickup.value[e]);
+	}
+	t = 0;
+	levEnd = world.pl.levitate ? max(0, (int)(world.pl.levitateStart + LEVITATE_TICKS - start)) : 0;
+	collect(coinCell, coinValue, cur, out);
+	// legs only ever lead on from here, so this bounds every later leg too
+	mark(cur, t, levEnd);
+
+	// legs: nearest coin first, the goal once none are left
+	for(;;){
+		best = -1;
+		for(i=0;i<(int)coinCell.size();i++)
+			if(best < 0 || distance(coinCell[i], cur, width) < distance(coinCell[best], cur, width))
+				best = i;
+		target = best >= 0 ? coinCell[best] : goal;
+
+		node = target >= 0 && reach[target] ? search(cur, t, levEnd, target, out.expanded) : -1;
+		if(node < 0){
+			if(best < 0)
+				return true;
+			coinCell.erase(coinCell.begin() + best);
+			coinValue.erase(coinValue.begin() + best);
+			reached = false;
+			continue;
+		}
+
+		first = out.plan.size();
+		for(i=node;nodes[i].parent>=0;i=nodes[i].parent){
+			const Node &n = nodes[i], &from = nodes[n.parent];
+			if(n.action < 0)
+				continue;
+			PlanStep s;
+			s.tick = start + from.t;
+			s.release = n.action == ACT_JUMP ? s.tick + arc.ticks : 0;
+			s.action = n.action;
+			s.dir = n.dir;
+			s.from = from.cell;
+			s.to = n.cell;
+			out.plan.push_back(s);
+		}
+		reverse(out.plan.begin() + first, out.plan.end());
+		for(;first<out.plan.size();first++){
+			const PlanStep &s = out.plan[first];
+			if(s.action == ACT_JUMP)
+				collect(coinCell, coinValue, s.from + stepX[s.dir] + stepZ[s.dir]*width, out);
+			collect(coinCell, coinValue, s.to, out);
+		}
+		cur = nodes[node].cell;
+		t = nodes[node].t;
+		levEnd = nodes[node].levEnd;
+
+		if(best < 0 && coinCell.empty()){
+			out.ticks = t;
+			out.winnable = reached;
+			return true;
+		}
+	}
+}
+
+Bot::Bot(){
+	next = 0;
+	releaseAt = -1;
+	retryAt = 0;
+	planned = false;
+	lives = 0;
+}
+
+static InputEvent keyEvent(int code, int action){
+	InputEvent ev;
+	ev.time = 0;
+	ev.type = INPUT_KEY;
+	ev.code = code;
+	ev.action = action;
+	ev.x = ev.y = 0;
+	return ev;
+}
+
+/* Arrow key that walks in dir from the current camera */
+static int arrowKey(World &world, int dir){
+	switch(world.arrowDir(dir)){
+		case DIR_POSX:
+			return KEY_RIGHT;
+		case DIR_NEGZ:
+			return KEY_UP;
+		case DIR_NEGX:
+			return KEY_LEFT;
+		default:
+			return KEY_DOWN;
+	}
+}
+
+void Bot::think(World &world, vector<InputEvent> &out){
+	int p = world.player;
+	if(world.status != STATUS_PLAYING)
+		return;
+	if(releaseAt >= 0){
+		if(world.tick >= releaseAt){
+			out.push_back(keyEvent(KEY_SPACE, ACTION_RELEASE));
+			releaseAt = -1;
+		}
+		return;
+	}
+	if(world.pl.jump)
+		return;
+	if(world.pl.jumpStart >= 0){
+		// a jump that landed without its key let go; finish it first
+		out.push_back(keyEvent(KEY_SPACE, ACTION_RELEASE));
+		return;
+	}
+
+	int here = world.cellAt(world.transform.x[p], world.transform.z[p]);
+	bool onPlan = planned && world.pl.lives == lives && next < result.plan.size() && result.plan[next].from == here && world.tick <= result.plan[next].tick;
+	if(!onPlan){
+		if(world.tick < retryAt)
+			return;
+		planned = solver.solve(world, result) && !result.plan.empty();
+		next = 0;
+		lives = world.pl.lives;
+		if(!planned){
+			retryAt = world.tick + SOLVER_PHASES;
+			return;
+		}
+	}
+
+	const PlanStep &s = result.plan[next];
+	if(world.tick != s.tick)
+		return;
+	out.push_back(keyEvent(arrowKey(world, s.dir), ACTION_PRESS));
+	out.push_back(keyEvent(arrowKey(world, s.dir), ACTION_RELEASE));
+	if(s.action == ACT_JUMP){
+		out.push_back(keyEvent(KEY_SPACE, ACTION_PRESS));
+		releaseAt = s.release;
+	}
+	next++;
+}
@@ -0,0 +1,158 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <vector>
+
+#include "world.h"
+
+/* Route planner for a generated level. It searches over (cell, tick)
+   with A*, stepping the player the way World::step does: single cell
+   walks, directional jumps (a walk followed by the leap arc), pits,
+   moving tiles at their predicted heights and levitation once the can is
+   picked up. Obstacles are predicted tick by tick with the world's own
+   reversal and respawn rules, so a plan avoids every hit.
+
+   The closed set is a bitset over (cell, tick % SOLVER_PHASES, can
+   state): reaching a cell again on the same phase is treated as no
+   better than the first arrival. The levels are not strictly periodic,
+   so this trades completeness for one bit per state. Coins are taken
+   nearest first, each leg its own search. */
+
+#define SOLVER_PHASES 256
+/* A leg that needs more ticks or nodes than this counts as unreachable */
+#define SOLVER_HORIZON 20000
+#define SOLVER_MAX_NODES (1<<22)
+/* Larger grids are not planned: the closed set takes SOLVER_PHASES*3
+   bits a cell, 96 MB at this size */
+#define SOLVER_MAX_CELLS (1<<20)
+/* Floats of predicted obstacle motion kept per solve (64 MB); ticks
+   past that count as hits, so legs that far out are unreachable */
+#define SOLVER_MAX_TRACK (1<<24)
+
+enum SolverAction {
+	ACT_WALK,
+	ACT_JUMP
+};
+
+/* One input of a plan. The walk or jump key goes in while world.tick is
+   tick; a jump's key is let go while world.tick is release. */
+struct PlanStep {
+	long tick;
+	long release;
+	int action;
+	int dir;
+	int from;	// cell the player stands on when the key goes in
+	int to;	// cell the player stands on once the step is done
+};
+
+struct SolveResult {
+	bool winnable;
+	int coins;	// coins the plan collects
+	int score;	// score at the goal, no hits are ever taken
+	long ticks;	// ticks until the player stands on the goal
+	long expanded;	// search nodes expanded over all legs
+	std::vector<PlanStep> plan;
+};
+
+class Solver{
+	public:
+		Solver();
+		/* Plan from the world's current state: every reachable coin, then
+		   the goal. Returns false if the player is in mid-air or the grid
+		   has more than SOLVER_MAX_CELLS cells. */
+		bool solve(World &world, SolveResult &out);
+
+	private:
+		struct Node {
+			int cell;
+			int t;	// ticks since the solve started
+			int levEnd;	// tick the levitation ends, 0 before the can is taken
+			int parent;
+			int action;	// -1 for a wait
+			int dir;
+		};
+
+		struct Open {
+			int f, g, node;
+			bool operator<(const Open &o) const { return f > o.f || (f == o.f && g < o.g); }
+		};
+
+		/* Moving brick as it was at the start of the solve */
+		struct Mover {
+			float y, vy, lo, hi;
+			long turn;
+		};
+
+		/* Obstacle motion, predicted forward one tick at a time */
+		struct Body {
+			float x, y, z, vy, lo, hi, radius;
+			long turn;
+		};
+
+		/* Relative path of a jump after its first walked cell */
+		struct Arc {
+			int ticks;	// ticks in the air, the key is let go after these
+			std::vector<float> along;
+			std::vector<float> height;
+			std::vector<int> low;	// ticks where it is not above the floor
+		};
+
+		int width, depth;
+		long start;
+		const unsigned char *solid;
+		std::vector<int> moverOf;	// per cell, index into movers or -1
+		std::vector<Mover> movers;
+		float playerRadius;
+		int canCell;
+		bool canActive;
+		float levY;	// height while levitating
+		Arc arc;
+
+		Rng rng;
+		std::vector<Body> bodies;
+		std::vector<float> track;	// x, y, z, radius, vy per obstacle per predicted tick
+		long tracked;
+
+		std::vector<unsigned char> reach;
+
+		std::vector<Node> nodes;
+		std::vector<Open> open;
+		std::vector<unsigned int> closed;
+		std::vector<size_t> closedUsed;
+
+		void load(World &world);
+		void buildArc();
+		int landing(int c1, int dir);
+		void flood(std::vector<int> &queue, int budget);
+		void mark(int from, int t, int levEnd);
+		float brickY(int c, long t);
+		const float *obstaclesAt(long t);
+		bool hit(const float p0[3], const float p1[3], long t);
+		bool levitating(const Node &n, int t){ return n.levEnd > t; }
+		float standY(int c, int t, bool lev);
+		void place(int c, int t, bool lev, float p[3]);
+		bool arrive(const float p[3], int c, int t, int &levEnd);
+		bool seen(const Node &m);
+		bool close(const Node &n);
+		int push(const Node &n, int target);
+		int search(int from, int t, int levEnd, int target, long &expanded);
+};
+
+class Bot{
+	public:
+		Bot();
+		/* Inputs to apply before the world's next step. Replans whenever
+		   the player is not where the plan expects. */
+		void think(World &world, std::vector<InputEvent> &out);
+
+	private:
+		Solver solver;
+		SolveResult result;
+		size_t next;
+		long releaseAt;
+		long retryAt;	// tick to try again after finding no plan
+		bool planned;
+		int lives;
+};
+
+#endif
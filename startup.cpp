@@ -0,0 +1,117 @@
+#include <cstring>
+#include <ctime>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "startup.h"
+#include "profile.h"
+
+StartupTimes startup;
+
+StartupTimes::StartupTimes(){
+	count = 0;
+	last = 0;
+	beforeMainMs = -1;
+	mainMs = 0;
+	peakRssKb = 0;
+	done = false;
+}
+
+static long peakRss(){
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0;
+	return usage.ru_maxrss;	// kB on Linux
+}
+
+/* Age of the process in ms: its start time in clock ticks since boot,
+   from field 22 of /proc/self/stat, against the boot clock */
+static double processAge(){
+	char buf[1024], *p;
+	unsigned long long started;
+	struct timespec now;
+	size_t n;
+	int field;
+	FILE *fp = fopen("/proc/self/stat", "r");
+	if(!fp)
+		return -1;
+	n = fread(buf, 1, sizeof(buf)-1, fp);
+	fclose(fp);
+	buf[n] = 0;
+	// the command name is in parentheses and may hold spaces
+	p = strrchr(buf, ')');
+	if(!p)
+		return -1;
+	for(field=2;field<22 && p;field++)
+		p = strchr(p+1, ' ');
+	if(!p || sscanf(p, "%llu", &started) != 1 || clock_gettime(CLOCK_BOOTTIME, &now) < 0)
+		return -1;
+	return (now.tv_sec + now.tv_nsec/1e9 - (double)started/sysconf(_SC_CLK_TCK))*1000;
+}
+
+void StartupTimes::begin(){
+	beforeMainMs = processAge();
+	last = profileNow();
+	count = 0;
+	done = false;
+}
+
+void StartupTimes::mark(const char *name){
+	long long now;
+	int i;
+	if(done || !last)
+		return;
+	now = profileNow();
+	for(i=0;i<count;i++)
+		if(!strcmp(names[i], name))
+			break;
+	if(i == count){
+		if(count == STARTUP_PHASES)
+			return;
+		names[count] = name;
+		ms[count] = 0;
+		count++;
+	}
+	ms[i] += (now - last)/1e6;
+	mainMs += (now - last)/1e6;
+	rssKb[i] = peakRssKb = peakRss();
+	last = now;
+}
+
+void StartupTimes::firstFrame(){
+	mark("first frame");
+	done = true;
+}
+
+double StartupTimes::timeToFirstFrame() const {
+	return (beforeMainMs >= 0 ? beforeMainMs : 0) + mainMs;
+}
+
+void StartupTimes::report(FILE *fp) const {
+	int i;
+	if(beforeMainMs >= 0)
+		fprintf(fp, "startup %-16s %9.2f ms\n", "before main", beforeMainMs);
+	for(i=0;i<count;i++)
+		fprintf(fp, "startup %-16s %9.2f ms  peak RSS %6ld kB\n", names[i], ms[i], rssKb[i]);
+	fprintf(fp, "time to first frame %.2f ms%s, peak RSS %ld kB\n", timeToFirstFrame(), beforeMainMs >= 0 ? "" : " (from main)", peakRssKb);
+}
+
+bool StartupTimes::writeJson(const char *path) const {
+	int i;
+	FILE *fp = fopen(path, "w");
+	if(!fp){
+		fprintf(stderr, "Cannot write %s\n", path);
+		return false;
+	}
+	fprintf(fp, "{\"time_to_first_frame_ms\":%.3f,\"from_exec\":%s,\"peak_rss_kb\":%ld,", timeToFirstFrame(), beforeMainMs >= 0 ? "true" : "false", peakRssKb);
+	if(beforeMainMs >= 0)
+		fprintf(fp, "\"before_main_ms\":%.3f,", beforeMainMs);
+	else
+		fprintf(fp, "\"before_main_ms\":null,");
+	fprintf(fp, "\"phases\":[\n");
+	for(i=0;i<count;i++)
+		fprintf(fp, "%s{\"name\":\"%s\",\"ms\":%.3f,\"peak_rss_kb\":%ld}", i ? ",\n" : "", names[i], ms[i], rssKb[i]);
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <cstdio>
+
+/* Wall-clock breakdown of startup, from exec to the first frame on
+   screen. Phases run back to back: mark() ends the phase in progress,
+   so every moment from begin() to firstFrame() belongs to exactly one
+   of them, and marking a name twice adds to the same phase. The time
+   before main() (loading and static constructors) is read from
+   /proc/self/stat, at the kernel's clock tick resolution, and left out
+   where /proc is not there. The peak RSS is taken from getrusage() at
+   the end of every phase. Main thread only. */
+
+#define STARTUP_PHASES 16
+
+class StartupTimes{
+	public:
+		StartupTimes();
+		/* At the top of main() */
+		void begin();
+		/* The phase that just ended; names must be string literals */
+		void mark(const char *name);
+		/* Once the first frame has been presented: ends the last phase,
+		   after which marks are ignored */
+		void firstFrame();
+		bool finished() const { return done; }
+		/* ms from exec, or from main() if that is unknown */
+		double timeToFirstFrame() const;
+		void report(FILE *fp) const;
+		bool writeJson(const char *path) const;
+
+	private:
+		const char *names[STARTUP_PHASES];
+		double ms[STARTUP_PHASES];
+		long rssKb[STARTUP_PHASES];	// peak RSS at the end of the phase
+		int count;
+		long long last;	// ns on the steady clock, end of the last phase
+		double beforeMainMs;	// -1 if unknown
+		double mainMs;	// begin() to firstFrame()
+		long peakRssKb;
+		bool done;
+};
+
+extern StartupTimes startup;
+
+#endif
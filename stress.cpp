@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "stress.h"
+
+using namespace std;
+
+const char *stressKnobNames[STRESS_KNOBS] = { "size", "coins", "obstacles", "moving", "cans" };
+
+#define MAX_CELLS (1<<24)	// keeps width*depth and the arena sizes in an int
+
+void defaultLevel(ReplayHeader &level){
+	memcpy(level.magic, REPLAY_MAGIC, 4);
+	level.version = REPLAY_VERSION;
+	level.seed = 1;
+	level.width = 10;
+	level.depth = 10;
+	level.coins = 6;
+	level.obstacles = 3;
+	level.movingPercent = 5;
+	level.cans = 1;
+}
+
+bool levelOption(int argc, char **argv, int &a, ReplayHeader &level){
+	if(!strcmp(argv[a],"--seed") && a+1<argc)
+		level.seed = strtoul(argv[++a],NULL,10);
+	else if(!strcmp(argv[a],"--size") && a+2<argc){
+		level.width = atoi(argv[++a]);
+		level.depth = atoi(argv[++a]);
+	}
+	else if(!strcmp(argv[a],"--coins") && a+1<argc)
+		level.coins = atoi(argv[++a]);
+	else if(!strcmp(argv[a],"--obstacles") && a+1<argc)
+		level.obstacles = atoi(argv[++a]);
+	else if(!strcmp(argv[a],"--moving") && a+1<argc)
+		level.movingPercent = atoi(argv[++a]);
+	else if(!strcmp(argv[a],"--cans") && a+1<argc)
+		level.cans = atoi(argv[++a]);
+	else
+		return false;
+	return true;
+}
+
+const char *checkLevel(const ReplayHeader &level){
+	if(level.width < 2 || level.depth < 2)
+		return "--size needs at least 2 2";
+	if((long long)level.width*level.depth > MAX_CELLS)
+		return "--size is over 16M cells";
+	if(level.coins < 0 || level.obstacles < 0 || level.cans < 0)
+		return "--coins, --obstacles and --cans cannot be negative";
+	if(level.coins > MAX_CELLS || level.obstacles > MAX_CELLS || level.cans > MAX_CELLS)
+		return "--coins, --obstacles and --cans go up to 16M";
+	if(level.movingPercent < 0 || level.movingPercent > 100)
+		return "--moving is a percentage, 0 to 100";
+	return NULL;
+}
+
+bool parseSweep(const char *knob, const char *list, Sweep &sweep){
+	const char *p = list;
+	char *end;
+	long v;
+	int k;
+	sweep.knob = -1;
+	sweep.values.clear();
+	for(k=0;k<STRESS_KNOBS;k++)
+		if(!strcmp(knob, stressKnobNames[k]))
+			sweep.knob = k;
+	if(sweep.knob < 0)
+		return false;
+	for(;;){
+		v = strtol(p, &end, 10);
+		if(end == p)
+			return false;
+		sweep.values.push_back((int)v);
+		if(!*end)
+			return true;
+		if(*end != ',')
+			return false;
+		p = end + 1;
+	}
+}
+
+ReplayHeader sweepLevel(const ReplayHeader &base, const Sweep &sweep, size_t i){
+	ReplayHeader level = base;
+	int v = sweep.values[i];
+	switch(sweep.knob){
+		case KNOB_SIZE:
+			level.width = level.depth = v;
+			break;
+		case KNOB_COINS:
+			level.coins = v;
+			break;
+		case KNOB_OBSTACLES:
+			level.obstacles = v;
+			break;
+		case KNOB_MOVING:
+			level.movingPercent = v;
+			break;
+		case KNOB_CANS:
+			level.cans = v;
+			break;
+	}
+	return level;
+}
+
+string sweepName(const Sweep &sweep, size_t i){
+	char name[64];
+	snprintf(name, sizeof(name), "%s-%d", stressKnobNames[sweep.knob], sweep.values[i]);
+	return name;
+}
@@ -0,0 +1,41 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <string>
+#include <vector>
+
+#include "replay.h"
+
+/* Level knobs for scaling tests: grid size, coins, obstacles, the share
+   of moving tiles and cans, taken from the command line into a
+   ReplayHeader so a stressed level records and replays like any other.
+   A sweep steps one knob through a list of values and keeps the seed
+   and every other knob, so the same command line builds the same scenes
+   for the renderer's benchmark and for the simulation's. */
+
+enum StressKnob { KNOB_SIZE, KNOB_COINS, KNOB_OBSTACLES, KNOB_MOVING, KNOB_CANS, STRESS_KNOBS };
+
+extern const char *stressKnobNames[STRESS_KNOBS];
+
+struct Sweep {
+	int knob;	// -1 for no sweep
+	std::vector<int> values;
+	Sweep() : knob(-1) {}
+};
+
+/* The original 10x10 maze, seed 1 */
+void defaultLevel(ReplayHeader &level);
+/* Takes the level option at argv[a] and its values into level, leaving
+   a on the last of them; false if argv[a] is not a level option */
+bool levelOption(int argc, char **argv, int &a, ReplayHeader &level);
+/* Why the level cannot be built, or NULL if it can */
+const char *checkLevel(const ReplayHeader &level);
+/* knob is one of stressKnobNames ("size" sets both sides), list holds
+   comma-separated values */
+bool parseSweep(const char *knob, const char *list, Sweep &sweep);
+/* The level at point i of the sweep */
+ReplayHeader sweepLevel(const ReplayHeader &base, const Sweep &sweep, size_t i);
+/* Knob and value, as in "obstacles-1000" */
+std::string sweepName(const Sweep &sweep, size_t i);
+
+#endif
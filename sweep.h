@@ -0,0 +1,33 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cmath>
+
+/* Continuous collision for one tick's motion. Both bodies move in a
+   straight line from their position at the start of the tick (a0, b0) to
+   the one at its end (a1, b1); the result is the time of impact as a
+   fraction of the tick in [0, 1], or -1 if they never come within r. A
+   fast body can then not pass through another between two ticks, however
+   long the tick is. */
+inline float sweepSpheres(const float a0[3], const float a1[3], const float b0[3], const float b1[3], float r){
+	float d[3], v[3], a = 0, b = 0, c = -r*r, disc, s;
+	int i;
+	for(i=0;i<3;i++){
+		d[i] = a0[i] - b0[i];
+		v[i] = (a1[i] - b1[i]) - d[i];
+		a += v[i]*v[i];
+		b += d[i]*v[i];
+		c += d[i]*d[i];
+	}
+	if(c <= 0)
+		return 0;	// touching at the start of the tick
+	if(a == 0 || b >= 0)
+		return -1;	// not closing in
+	disc = b*b - a*c;
+	if(disc < 0)
+		return -1;
+	s = (-b - sqrt(disc))/a;
+	return s <= 1 ? s : -1;
+}
+
+#endif
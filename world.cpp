@@ -0,0 +1,814 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "world.h"
+#include "sweep.h"
+#include "profile.h"
+
+using namespace std;
+
+/* Arena sections, in layout order. Per-entity arrays come first, then the
+   grid, then the timer nodes. */
+enum {
+	A_MASK, A_KIND,
+	A_X, A_Y, A_Z, A_ANGLE,
+	A_VY, A_LO, A_HI, A_TIMER,
+	A_RADIUS,
+	A_ACTIVE, A_VALUE,
+	A_MESH, A_VISIBLE,
+	A_CELL, A_SOLID, A_MOVING,
+	A_NODE,
+	A_SECTIONS
+};
+
+static const size_t elemSize[A_SECTIONS] = {
+	sizeof(unsigned int), sizeof(int),
+	sizeof(float), sizeof(float), sizeof(float), sizeof(float),
+	sizeof(float), sizeof(float), sizeof(float), sizeof(int),
+	sizeof(float),
+	1, sizeof(int),
+	sizeof(int), 1,
+	sizeof(int), 1, 1,
+	sizeof(TimerNode)
+};
+
+static int sectionCount(int s, int capacity, int cells, int nodes){
+	return s < A_CELL ? capacity : s < A_NODE ? cells : nodes;
+}
+
+/* Offset of every section, each starting on a cache line; returns the total */
+static size_t layout(int capacity, int cells, int nodes, size_t *off){
+	size_t at = 0;
+	int s;
+	for(s=0;s<A_SECTIONS;s++){
+		off[s] = at;
+		at += sectionCount(s, capacity, cells, nodes)*elemSize[s];
+		at = (at + 63) & ~(size_t)63;
+	}
+	return at;
+}
+
+/* Timer callbacks */
+static void reverseTimer(World &w, int e){
+	w.motion.timer[e] = -1;
+	w.motion.vy[e] = -w.motion.vy[e];
+	w.armReversal(e);
+}
+
+static void respawnTimer(World &w, int e){
+	w.respawnObstacle(e);
+	w.schedule(w.tick + RESPAWN_TICKS, respawnTimer, e);
+}
+
+static void levitateTimer(World &w, int){
+	w.pl.levitateTimer = -1;
+	w.endLevitation();
+}
+
+World::World(){
+	mem = NULL;
+	size = 0;
+	capacity = 0;
+	cellCapacity = 0;
+	nodeCapacity = 0;
+	reserve(0, 0, 0);
+	clear();
+}
+
+/* Keeps the arena; only the counts go back to zero */
+void World::clear(){
+	count = 0;
+	width = 0;
+	depth = 0;
+	moverBegin = moverEnd = 0;
+	obstacleBegin = obstacleEnd = 0;
+	canBegin = canEnd = 0;
+	coinBegin = coinEnd = 0;
+	player = -1;
+	totalCoins = 0;
+	tick = 0;
+	status = STATUS_PLAYING;
+	timers.clear(0);
+
+	pl.dir = DIR_NONE;
+	pl.lives = 3;
+	pl.coins = 0;
+	pl.score = 0;
+	pl.hitno = 0;
+	pl.speed = 10;
+	pl.jump = false;
+	pl.levitate = false;
+	pl.onMTile = false;
+	pl.onMTileJump = false;
+	pl.move1 = false;
+	pl.jumpStart = -1;
+	pl.beforeht = 2.5;
+	pl.beforeht1 = 2.5;
+	pl.lastX = 0;
+	pl.lastY = 2.5;
+	pl.lastZ = 0;
+	pl.levitateStart = 0;
+	pl.levitateTimer = -1;
+
+	ctl.view = 0;
+	ctl.choice = 0;
+	ctl.pressNext = false;
+	ctl.pressMove = false;
+	ctl.moves = 0;
+	ctl.zoom = 0;
+	changeCam(0);
+}
+
+/* Fresh arena of n bytes, aligned to a cache line, every page dirty */
+void World::allocate(size_t n){
+	arena.assign(n + 63, 0);
+	mem = (unsigned char *)(((size_t)&arena[0] + 63) & ~(size_t)63);
+	size = n;
+	dirty.reset(mem, size);
+	dirty.touch(mem, size);
+}
+
+/* Point every array at its section of the arena */
+void World::bind(){
+	size_t off[A_SECTIONS];
+	layout(capacity, cellCapacity, nodeCapacity, off);
+	mask = (unsigned int *)(mem + off[A_MASK]);
+	kind = (int *)(mem + off[A_KIND]);
+	transform.x = (float *)(mem + off[A_X]);
+	transform.y = (float *)(mem + off[A_Y]);
+	transform.z = (float *)(mem + off[A_Z]);
+	transform.angle = (float *)(mem + off[A_ANGLE]);
+	motion.vy = (float *)(mem + off[A_VY]);
+	motion.lo = (float *)(mem + off[A_LO]);
+	motion.hi = (float *)(mem + off[A_HI]);
+	motion.timer = (int *)(mem + off[A_TIMER]);
+	collider.radius = (float *)(mem + off[A_RADIUS]);
+	pickup.active = mem + off[A_ACTIVE];
+	pickup.value = (int *)(mem + off[A_VALUE]);
+	renderable.mesh = (int *)(mem + off[A_MESH]);
+	renderable.visible = mem + off[A_VISIBLE];
+	cell = (int *)(mem + off[A_CELL]);
+	solid = mem + off[A_SOLID];
+	moving = mem + off[A_MOVING];
+	timers.attach((TimerNode *)(mem + off[A_NODE]), nodeCapacity);
+	timers.pages = &dirty;
+}
+
+void World::reserve(int cap, int cells, int nodes){
+	size_t from[A_SECTIONS], to[A_SECTIONS], n;
+	vector<unsigned char> old;
+	unsigned char *src = mem;
+	int s;
+	cap = max(cap, capacity);
+	cells = max(cells, cellCapacity);
+	nodes = max(nodes, nodeCapacity);
+	if(cap == capacity && cells == cellCapacity && nodes == nodeCapacity && mem)
+		return;
+
+	layout(capacity, cellCapacity, nodeCapacity, from);
+	n = layout(cap, cells, nodes, to);
+	old.swap(arena);
+	allocate(n);
+	if(src){
+		for(s=0;s<A_SECTIONS;s++)
+			memcpy(mem + to[s], src + from[s], sectionCount(s, capacity, cellCapacity, nodeCapacity)*elemSize[s]);
+	}
+	capacity = cap;
+	cellCapacity = cells;
+	nodeCapacity = nodes;
+	bind();
+}
+
+int World::schedule(long due, TimerFunc fn, int arg){
+	if(timers.full())
+		reserve(capacity, cellCapacity, nodeCapacity*2 + 8);
+	return timers.schedule(due, fn, arg);
+}
+
+/* Append an entity with the given components; every array gets a slot so
+   indices stay aligned, entities without a component keep neutral values */
+int World::spawn(int k, unsigned int m){
+	if(count == capacity)
+		reserve(capacity*2 + 16, cellCapacity, nodeCapacity);
+	int id = count++;
+	mask[id] = m;
+	kind[id] = k;
+	transform.x[id] = 0;
+	transform.y[id] = 0;
+	transform.z[id] = 0;
+	transform.angle[id] = 0;
+	motion.vy[id] = 0;
+	motion.lo[id] = -HUGE_VALF;
+	motion.hi[id] = HUGE_VALF;
+	motion.timer[id] = -1;
+	collider.radius[id] = 0;
+	pickup.active[id] = 0;
+	pickup.value[id] = 0;
+	renderable.mesh[id] = MESH_NONE;
+	renderable.visible[id] = 1;
+	return id;
+}
+
+/* Build a random level; the layout rules are the ones initGL used for the
+   10x10 maze. The same seed always gives the same level and the same
+   obstacle respawns. Entities are spawned movers first (moving bricks,
+   obstacles), then static bricks, the cans and the coins. movingPercent
+   of the cells are picked to move (with repeats, as before) and a hole
+   is punched in 8% of them. */
+void World::generate(int w, int d, int coins, int obstacles, unsigned int s, int movingPercent, int cans){
+	int i, num, e;
+	int cells;
+
+	clear();
+	cells = w*d;
+	// every obstacle holds a reversal and a respawn timer, moving bricks a reversal
+	reserve(cells + obstacles + coins + cans + 1, cells, 2*obstacles + cells*movingPercent/100 + 2);
+	seed = s;
+	levelRng.seed(s, RNG_LEVEL);
+	obstacleRng.seed(s, RNG_OBSTACLE);
+	width = w;
+	depth = d;
+	memset(solid, 1, cells);
+	memset(moving, 0, cells);
+
+	player = spawn(KIND_PLAYER, COMP_TRANSFORM | COMP_COLLIDER | COMP_RENDERABLE);
+	transform.y[player] = 2.5;
+	collider.radius[player] = sqrt(3)/2;
+	renderable.mesh[player] = MESH_PERSON;
+
+	for(i=0;i<cells*8/100;i++){
+		num = levelRng.below(cells);
+		solid[num] = 0;
+	}
+	for(i=0;i<cells*movingPercent/100;i++){
+		num = levelRng.below(cells);
+		moving[num] = 1;
+		solid[num] = 1;
+	}
+	// start, the cell next to it and the goal are always plain bricks
+	solid[0] = 1;
+	solid[1] = 1;
+	solid[cells-1] = 1;
+	moving[0] = 0;
+	moving[1] = 0;
+	moving[cells-1] = 0;
+	if(w > 6 && d > 8)
+		solid[cellIndex(6, 8)] = 0;
+
+	moverBegin = count;
+	for(i=0;i<cells;i++)
+		if(moving[i])
+			cell[i] = spawn(KIND_BRICK, COMP_TRANSFORM | COMP_MOTION | COMP_RENDERABLE);
+
+	obstacleBegin = count;
+	for(i=0;i<obstacles;i++){
+		e = spawn(KIND_OBSTACLE, COMP_TRANSFORM | COMP_MOTION | COMP_COLLIDER | COMP_RENDERABLE);
+		transform.x[e] = levelRng.below(w-1) + 1;
+		transform.y[e] = 2;
+		transform.z[e] = levelRng.below(d-1) + 1;
+		motion.vy[e] = obstacleSpeed(levelRng);
+		motion.lo[e] = 2;
+		motion.hi[e] = 4;
+		collider.radius[e] = 0.5;
+		renderable.mesh[e] = MESH_OBSTACLE;
+		armReversal(e);
+		schedule(RESPAWN_TICKS, respawnTimer, e);
+	}
+	obstacleEnd = moverEnd = count;
+
+	for(i=0;i<cells;i++)
+		if(!moving[i])
+			cell[i] = spawn(KIND_BRICK, COMP_TRANSFORM | COMP_MOTION | COMP_RENDERABLE);
+
+	canBegin = count;
+	for(i=0;i<cans;i++){
+		e = spawn(KIND_CAN, COMP_TRANSFORM | COMP_PICKUP | COMP_RENDERABLE);
+		transform.x[e] = levelRng.below(w/2) + w*3/10;
+		transform.y[e] = 3;
+		transform.z[e] = levelRng.below(d/2) + d*3/10;
+		pickup.active[e] = 1;
+		renderable.mesh[e] = MESH_CAN;
+	}
+	canEnd = count;
+
+	coinBegin = count;
+	for(i=0;i<coins;i++){
+		e = spawn(KIND_COIN, COMP_TRANSFORM | COMP_PICKUP | COMP_RENDERABLE);
+		transform.x[e] = levelRng.below(w);
+		transform.y[e] = 2;
+		transform.z[e] = levelRng.below(d);
+		pickup.active[e] = 1;
+		pickup.value[e] = 10;
+		renderable.mesh[e] = MESH_COIN;
+	}
+	coinEnd = count;
+	totalCoins = coins;
+
+	// settle the brick components now that the grid is final
+	for(i=0;i<cells;i++){
+		e = cell[i];
+		transform.x[e] = i%w;
+		transform.z[e] = i/w;
+		renderable.mesh[e] = (i == cells-1) ? MESH_GOAL_BRICK : MESH_BRICK;
+		renderable.visible[e] = solid[i];
+		if(moving[i]){
+			motion.vy[e] = -FRAME_TO_TICK*(0.02 + (i/w)*0.002 + (i%w)*0.002);
+			motion.lo[e] = -2.75;
+			motion.hi[e] = 2.55;
+			armReversal(e);
+		}
+	}
+	touch(mem, size);
+}
+
+static unsigned int fnv(unsigned int h, const void *data, size_t n){
+	const unsigned char *p = (const unsigned char *)data;
+	size_t i;
+	for(i=0;i<n;i++)
+		h = (h ^ p[i]) * 16777619u;
+	return h;
+}
+
+/* Hash of the state that gameplay depends on, used to check that a replay
+   ended where the recording did */
+unsigned int World::checksum(){
+	unsigned int h = 2166136261u;
+	int v[6] = { pl.lives, pl.coins, pl.score, pl.hitno, status, (int)tick };
+	h = fnv(h, v, sizeof(v));
+	h = fnv(h, transform.x, count*sizeof(float));
+	h = fnv(h, transform.y, count*sizeof(float));
+	h = fnv(h, transform.z, count*sizeof(float));
+	h = fnv(h, motion.vy, count*sizeof(float));
+	h = fnv(h, pickup.active, count);
+	return h;
+}
+
+/* Grid cell under a world position, -1 outside the grid */
+int World::cellAt(float x, float z){
+	int ix = (int)floor(x + 0.0001f), iz = (int)floor(z + 0.0001f);
+	if(ix < 0 || ix >= width || iz < 0 || iz >= depth)
+		return -1;
+	return cellIndex(ix, iz);
+}
+
+int World::brickAt(float x, float z){
+	int c = cellAt(x, z);
+	return c < 0 ? -1 : cell[c];
+}
+
+void World::input(const InputEvent &ev){
+	if(ev.type == INPUT_KEY && ev.action == ACTION_RELEASE){
+		switch(ev.code){
+			case KEY_T:
+				ctl.view=(ctl.view+1)%5;
+				break;
+			case KEY_SPACE:
+				endJump();
+				break;
+			case KEY_F:
+				pl.speed-=1;
+				if(pl.speed<=2)
+					pl.speed=2;
+				break;
+			case KEY_S:
+				pl.speed+=1;
+				break;
+			case KEY_P:
+				pl.dir=DIR_NONE;
+				break;
+			case KEY_C:
+				changeCam((ctl.choice+1)%4);
+				break;
+			case KEY_UP:
+			case KEY_DOWN:
+			case KEY_LEFT:
+			case KEY_RIGHT:
+				pl.move1=false;
+				break;
+			default:
+				break;
+		}
+	}
+	else if(ev.type == INPUT_KEY && ev.action == ACTION_PRESS){
+		switch(ev.code){
+			case KEY_SPACE:
+				startJump();
+				break;
+			case KEY_UP:
+				walk(arrowDir(DIR_NEGZ));
+				break;
+			case KEY_DOWN:
+				walk(arrowDir(DIR_POSZ));
+				break;
+			case KEY_LEFT:
+				walk(arrowDir(DIR_NEGX));
+				break;
+			case KEY_RIGHT:
+				walk(arrowDir(DIR_POSX));
+				break;
+			default:
+				break;
+		}
+	}
+	else if(ev.type == INPUT_BUTTON){
+		bool press = ev.action == ACTION_PRESS;
+		if(ev.code == BUTTON_LEFT)
+			ctl.pressNext = press;
+		if(ev.code == BUTTON_RIGHT){
+			ctl.pressMove = press;
+			pl.move1 = press;
+			if(!press)
+				ctl.moves = 0;
+		}
+	}
+	else if(ev.type == INPUT_CURSOR){
+		if(ctl.pressNext){
+			ctl.target[0] = ev.x/75-4;
+			ctl.target[1] = 1;
+			ctl.target[2] = ev.y/75-4;
+		}
+	}
+	else if(ev.type == INPUT_SCROLL){
+		if(ctl.pressNext){
+			float sx = (ctl.choice==2||ctl.choice==3) ? -1 : 1;
+			float sz = (ctl.choice==1||ctl.choice==2) ? -1 : 1;
+			ctl.eye[0] = ctl.base[0] + sx*ctl.zoom;
+			ctl.eye[1] = ctl.base[1] + ctl.zoom;
+			ctl.eye[2] = ctl.base[2] + sz*ctl.zoom;
+			ctl.zoom += -ev.y*0.5;
+		}
+		if(ctl.pressMove && ctl.moves%pl.speed==0){
+			ctl.moves++;
+			if(ev.x==1)
+				walk(arrowDir(DIR_NEGX));
+			else if(ev.x==-1)
+				walk(arrowDir(DIR_POSX));
+			else if(ev.y==1)
+				walk(arrowDir(DIR_NEGZ));
+			else if(ev.y==-1)
+				walk(arrowDir(DIR_POSZ));
+		}
+	}
+	touch(&transform.x[player], sizeof(float));
+	touch(&transform.y[player], sizeof(float));
+	touch(&transform.z[player], sizeof(float));
+}
+
+/* Helicopter camera presets, one per corner of the maze */
+void World::changeCam(int choice){
+	float sx = (choice==2||choice==3) ? -1 : 1;
+	float sz = (choice==1||choice==2) ? -1 : 1;
+	ctl.choice = choice;
+	ctl.base[0] = 8*sx;
+	ctl.base[1] = 8;
+	ctl.base[2] = 11*sz;
+	ctl.eye[0] = ctl.base[0];
+	ctl.eye[1] = ctl.base[1];
+	ctl.eye[2] = ctl.base[2];
+	ctl.target[0] = 4*sx;
+	ctl.target[1] = 2;
+	ctl.target[2] = 1*sz;
+}
+
+/* Arrow keys walk relative to the camera; views looking back along +z mirror them */
+int World::arrowDir(int dir){
+	if(ctl.view==1||ctl.view==2||ctl.choice==1||ctl.choice==2)
+		return (dir+1)%4 + 1;
+	return dir;
+}
+
+void World::walk(int dir){
+	pl.move1 = true;
+	if(pl.onMTile && transform.y[player] < 2.5)
+		return;
+	pl.dir = dir;
+	if(dir==DIR_POSX)
+		transform.x[player]+=1;
+	if(dir==DIR_NEGZ)
+		transform.z[player]-=1;
+	if(dir==DIR_NEGX)
+		transform.x[player]-=1;
+	if(dir==DIR_POSZ)
+		transform.z[player]+=1;
+}
+
+void World::startJump(){
+	if(pl.onMTile && transform.y[player] < 2.5){
+		pl.dir = DIR_NONE;
+		pl.onMTileJump = true;
+	}
+	if(pl.jumpStart < 0)
+		pl.jumpStart = tick;
+	pl.jump = true;
+}
+
+/* Snap back onto the grid when the jump key is released */
+void World::endJump(){
+	pl.jump = false;
+	pl.jumpStart = -1;
+	pl.dir = DIR_NONE;
+	transform.x[player] = (int)transform.x[player];
+	transform.y[player] = pl.beforeht;
+	if(pl.onMTileJump){
+		transform.y[player] = 2.5;
+		pl.onMTileJump = false;
+	}
+	transform.z[player] = (int)transform.z[player];
+	settle();
+}
+
+void World::step(){
+	if(status != STATUS_PLAYING)
+		return;
+	tick++;
+
+	timers.advance(*this, tick);
+	moveBodies();
+	spinCoins();
+	collectCoins();
+
+	if(!pl.jump)
+		pl.beforeht = transform.y[player];
+	if(!pl.onMTile)
+		pl.beforeht1 = transform.y[player];
+
+	{
+		PROFILE("collisions");
+		checkBelow();
+		checkBelowMoving();
+		checkCan();
+		checkObstacles();
+		checkBoundary();
+		checkHealth();
+	}
+	// the next tick's swept checks cover the moves from here on
+	settle();
+	leap();
+
+	if(pl.move1 && tick%pl.speed == 0)
+		moveHeld();
+
+	// systems move the player freely; its slots are marked once here
+	touch(&transform.x[player], sizeof(float));
+	touch(&transform.y[player], sizeof(float));
+	touch(&transform.z[player], sizeof(float));
+
+	if(pl.lives <= 0)
+		status = STATUS_LOST;
+	else if(pl.coins == totalCoins && transform.x[player] == width-1 && transform.z[player] == depth-1)
+		status = STATUS_WON;
+}
+
+/* Everything that moves is spawned into one range, so this is a plain
+   add over it without branching; turning around at the limits is left to
+   timers */
+void World::moveBodies(){
+	int i, n = moverEnd;
+	float *y = transform.y;
+	const float *vy = motion.vy;
+	for(i=moverBegin;i<n;i++)
+		y[i] += vy[i];
+	touch(y + moverBegin, (n - moverBegin)*sizeof(float));
+}
+
+/* Schedule the turn for the tick after a body passes its limit */
+void World::armReversal(int e){
+	if(motion.vy[e] == 0)
+		return;
+	timers.cancel(motion.timer[e]);
+	motion.timer[e] = schedule(tick + reversalDelay(transform.y[e], motion.vy[e], motion.lo[e], motion.hi[e]), reverseTimer, e);
+	touch(&motion.timer[e], sizeof(int));
+	touch(&motion.vy[e], sizeof(float));
+}
+
+void World::spinCoins(){
+	int i;
+	for(i=coinBegin;i<coinEnd;i++)
+		transform.angle[i] += 2*FRAME_TO_TICK;
+	touch(transform.angle + coinBegin, (coinEnd - coinBegin)*sizeof(float));
+}
+
+void World::collectCoins(){
+	int i;
+	float px = transform.x[player], pz = transform.z[player];
+	for(i=coinBegin;i<coinEnd;i++){
+		if(!pickup.active[i])
+			continue;
+		if(px == transform.x[i] && pz == transform.z[i]){
+			pickup.active[i] = 0;
+			renderable.visible[i] = 0;
+			touch(&pickup.active[i], 1);
+			touch(&renderable.visible[i], 1);
+			pl.score += pickup.value[i];
+			pl.coins++;
+		}
+	}
+}
+
+/* First time along the segment from..to, as a fraction in [0, 1], at
+   which the player is over a pit at floor height or below; -1 if never.
+   The segment is cut where it crosses cell edges, so a long step cannot
+   skip over a pit. */
+float World::sweepPit(const float from[3], const float to[3]){
+	float cut[64], dx = to[0] - from[0], dy = to[1] - from[1], dz = to[2] - from[2], s0, s1, y0, y1;
+	int n = 0, i, k, c, lo, hi;
+	cut[n++] = 0;
+	// cell edges sit just below the integers, as in cellAt()
+	lo = (int)floor(min(from[0], to[0]) + 0.0001f) + 1;
+	hi = (int)floor(max(from[0], to[0]) + 0.0001f);
+	for(k=lo;k<=hi && n<63;k++)
+		cut[n++] = (k - 0.0001f - from[0])/dx;
+	lo = (int)floor(min(from[2], to[2]) + 0.0001f) + 1;
+	hi = (int)floor(max(from[2], to[2]) + 0.0001f);
+	for(k=lo;k<=hi && n<63;k++)
+		cut[n++] = (k - 0.0001f - from[2])/dz;
+	cut[n++] = 1;
+	sort(cut, cut + n);
+	for(i=0;i+1<n;i++){
+		s0 = cut[i];
+		s1 = cut[i+1];
+		y0 = from[1] + dy*s0;
+		y1 = from[1] + dy*s1;
+		if(min(y0, y1) > 2.5)
+			continue;
+		c = cellAt(from[0] + dx*(s0 + s1)/2, from[2] + dz*(s0 + s1)/2);
+		if(c < 0 || solid[c])
+			continue;
+		return y0 <= 2.5 ? s0 : s0 + (s1 - s0)*(y0 - 2.5)/(y0 - y1);
+	}
+	c = cellAt(to[0], to[2]);
+	return c >= 0 && !solid[c] && to[1] <= 2.5 ? 1 : -1;
+}
+
+void World::checkBelow(){
+	float from[3] = { pl.lastX, pl.lastY, pl.lastZ };
+	float to[3] = { transform.x[player], transform.y[player], transform.z[player] };
+	if(sweepPit(from, to) >= 0)
+		fall();
+}
+
+void World::checkBelowMoving(){
+	int c = cellAt(transform.x[player], transform.z[player]);
+	float &posy = transform.y[player];
+	if(c >= 0 && moving[c] && !pl.jump && !pl.levitate){
+		pl.onMTile = true;
+		posy = transform.y[cell[c]] + 2.5;
+	}
+	else{
+		pl.onMTile = false;
+		if(posy >= 2.5){
+			posy = pl.beforeht1;
+			if(!pl.jump && !pl.levitate)
+				posy = 2.5;
+		}
+	}
+}
+
+void World::checkCan(){
+	int i;
+	for(i=canBegin;i<canEnd;i++){
+		if(!pickup.active[i])
+			continue;
+		if(transform.x[player] == transform.x[i] && transform.z[player] == transform.z[i]){
+			pickup.active[i] = 0;
+			renderable.visible[i] = 0;
+			touch(&pickup.active[i], 1);
+			touch(&renderable.visible[i], 1);
+			transform.y[player] = 4.5;
+			pl.levitate = true;
+			pl.levitateStart = tick;
+			timers.cancel(pl.levitateTimer);
+			pl.levitateTimer = schedule(tick + LEVITATE_TICKS, levitateTimer, 0);
+			settle();
+		}
+	}
+}
+
+/* Swept over the tick: the player from where the last step left it, each
+   obstacle from where it was before this tick's bounce */
+void World::checkObstacles(){
+	int i;
+	for(i=obstacleBegin;i<obstacleEnd;i++){
+		float p0[3] = { pl.lastX, pl.lastY, pl.lastZ };
+		float p1[3] = { transform.x[player], transform.y[player], transform.z[player] };
+		float o0[3] = { transform.x[i], transform.y[i] - motion.vy[i], transform.z[i] };
+		float o1[3] = { transform.x[i], transform.y[i], transform.z[i] };
+		float r = collider.radius[player] + collider.radius[i];
+		if(sweepSpheres(p0, p1, o0, o1, r) >= 0){
+			back();
+			pl.hitno++;
+		}
+	}
+}
+
+void World::checkBoundary(){
+	float x = transform.x[player], z = transform.z[player];
+	if(x < 0 || x > width-1 || z < 0 || z > depth-1)
+		fall();
+}
+
+void World::checkHealth(){
+	if(pl.hitno>=10)
+		fall();
+}
+
+/* Move along the jump arc by its change over this tick, so walks and knocks
+   taken in the air still add up. The arc only depends on time since
+   takeoff, so any tick length lands in the same place. */
+void World::leap(){
+	float &posy = transform.y[player];
+	if(!pl.jump)
+		return;
+	long k = tick - pl.jumpStart;
+	float t0 = jumpTime(k - 1), t1 = jumpTime(k);
+	posy += jumpHeight(t1) - jumpHeight(t0);
+	if(!pl.levitate && posy > 4.62)
+		pl.hitno++;
+	if(posy<pl.beforeht || k >= jumpTicks()){
+		posy=pl.beforeht;
+		pl.jump=false;
+	}
+	float dx = jumpRun(t1) - jumpRun(t0);
+	if(pl.dir==DIR_POSX)
+		transform.x[player]+=dx;
+	if(pl.dir==DIR_NEGZ)
+		transform.z[player]-=dx;
+	if(pl.dir==DIR_NEGX)
+		transform.x[player]-=dx;
+	if(pl.dir==DIR_POSZ)
+		transform.z[player]+=dx;
+}
+
+/* Keep walking while a direction is held */
+void World::moveHeld(){
+	if(pl.onMTile && transform.y[player] < 2.5)
+		return;
+	if(pl.dir==DIR_POSX)
+		transform.x[player]++;
+	if(pl.dir==DIR_NEGZ)
+		transform.z[player]--;
+	if(pl.dir==DIR_NEGX)
+		transform.x[player]--;
+	if(pl.dir==DIR_POSZ)
+		transform.z[player]++;
+}
+
+void World::respawnObstacle(int e){
+	transform.x[e] = obstacleRng.below(width-1) + 1;
+	transform.y[e] = 2;
+	transform.z[e] = obstacleRng.below(depth-1) + 1;
+	motion.vy[e] = obstacleSpeed(obstacleRng);
+	touch(&transform.x[e], sizeof(float));
+	touch(&transform.y[e], sizeof(float));
+	touch(&transform.z[e], sizeof(float));
+	armReversal(e);
+}
+
+void World::endLevitation(){
+	transform.y[player]=2.5;
+	pl.levitate=false;
+}
+
+/* Undo the last step after running into an obstacle */
+void World::back(){
+	if(pl.dir==DIR_POSX)
+		transform.x[player]--;
+	if(pl.dir==DIR_NEGZ)
+		transform.z[player]++;
+	if(pl.dir==DIR_NEGX)
+		transform.x[player]++;
+	if(pl.dir==DIR_POSZ)
+		transform.z[player]--;
+	transform.y[player]=2.5-pl.hitno*0.1;
+	pl.levitate=false;
+	timers.cancel(pl.levitateTimer);
+	pl.levitateTimer=-1;
+	pl.score--;
+	pl.speed=10;
+	pl.dir=DIR_NONE;
+	settle();
+}
+
+/* Lose a life and restart from the first cell */
+void World::fall(){
+	pl.lives--;
+	pl.hitno=0;
+	transform.x[player]=0;
+	transform.y[player]=2.5;
+	transform.z[player]=0;
+	pl.speed=10;
+	pl.dir=DIR_NONE;
+	pl.levitate=false;
+	timers.cancel(pl.levitateTimer);
+	pl.levitateTimer=-1;
+	settle();
+}
+
+/* The player was put somewhere rather than moved there: the next swept
+   checks start from here */
+void World::settle(){
+	pl.lastX = transform.x[player];
+	pl.lastY = transform.y[player];
+	pl.lastZ = transform.z[player];
+}
@@ -0,0 +1,310 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <cstddef>
+#include <vector>
+
+#include "scheduler.h"
+#include "pagemap.h"
+#include "input.h"
+#include "rng.h"
+
+/* Gameplay state of the maze, kept free of any GL so it can be stepped
+   without a window. Every object in the level is an entity: an index into
+   a set of parallel component arrays (structure-of-arrays). An entity owns
+   a component when its bit is set in World::mask; the arrays are dense,
+   so systems walk them front to back without chasing pointers.
+
+   All arrays, the grid and the timer nodes are carved out of one arena,
+   and every other field is plain data in WorldState, so a snapshot of the
+   whole game is one struct copy plus one memcpy. */
+
+enum EntityKind {
+	KIND_PLAYER,
+	KIND_BRICK,
+	KIND_COIN,
+	KIND_OBSTACLE,
+	KIND_CAN
+};
+
+enum ComponentBit {
+	COMP_TRANSFORM = 1<<0,
+	COMP_MOTION = 1<<1,
+	COMP_COLLIDER = 1<<2,
+	COMP_PICKUP = 1<<3,
+	COMP_RENDERABLE = 1<<4
+};
+
+/* Mesh the renderer should use for an entity */
+enum MeshID {
+	MESH_NONE,
+	MESH_PERSON,
+	MESH_BRICK,
+	MESH_GOAL_BRICK,
+	MESH_COIN,
+	MESH_OBSTACLE,
+	MESH_CAN
+};
+
+enum GameStatus {
+	STATUS_PLAYING,
+	STATUS_WON,
+	STATUS_LOST
+};
+
+/* Length of one simulation tick in seconds */
+#define TICK_SECONDS 0.025f
+/* Motion rates were tuned per drawn frame at 60Hz vsync; a 25ms tick spans 1.5 of those */
+#define FRAME_TO_TICK 1.5f
+/* Obstacles jump to a new place this often */
+#define RESPAWN_TICKS 240
+/* How long the can keeps the player afloat */
+#define LEVITATE_TICKS 320
+/* A jump peaks JUMP_APEX above its takeoff height and comes back down
+   JUMP_DISTANCE cells along its direction, JUMP_AIRTIME seconds later */
+#define JUMP_APEX 1.6f
+#define JUMP_DISTANCE 2.6f
+#define JUMP_AIRTIME 0.6f
+
+/* Player walking directions, as used by Player::dir */
+#define DIR_NONE 0
+#define DIR_POSX 1
+#define DIR_NEGZ 2
+#define DIR_NEGX 3
+#define DIR_POSZ 4
+
+/* Ticks from now until a body at y moving v per tick turns around; it
+   overshoots its limit by under one tick's travel */
+inline long reversalDelay(float y, float v, float lo, float hi){
+	float dist = v < 0 ? y - lo : hi - y;
+	float speed = v < 0 ? -v : v;
+	return (dist > 0 ? (long)(dist/speed) + 1 : 1) + 1;
+}
+
+/* The jump arc in closed form, so a landing is known at takeoff. Times
+   are seconds since takeoff. */
+inline float jumpHeight(float t){
+	return 4*JUMP_APEX*t*(JUMP_AIRTIME - t)/(JUMP_AIRTIME*JUMP_AIRTIME);
+}
+
+inline float jumpRun(float t){
+	return JUMP_DISTANCE*t/JUMP_AIRTIME;
+}
+
+/* Ticks after the jump key goes in that the player lands on */
+inline long jumpTicks(){
+	return (long)(JUMP_AIRTIME/TICK_SECONDS + 0.999f);
+}
+
+/* Time into the jump after this many ticks, stopping at the landing */
+inline float jumpTime(long ticks){
+	return ticks < jumpTicks() ? ticks*TICK_SECONDS : JUMP_AIRTIME;
+}
+
+/* Bounce speed of a newly placed obstacle */
+inline float obstacleSpeed(Rng &rng){
+	return FRAME_TO_TICK*((((float)rng.below(50))/1000) + 0.04);
+}
+
+/* Components, pointing into World's arena */
+struct Transform {
+	float *x, *y, *z;
+	float *angle;
+};
+
+/* Vertical bouncing between lo and hi at vy units per tick; the turn at
+   each limit is a scheduled timer, so the per-tick update is a plain add */
+struct Motion {
+	float *vy;
+	float *lo, *hi;
+	int *timer;
+};
+
+struct Collider {
+	float *radius;
+};
+
+struct Pickup {
+	unsigned char *active;
+	int *value;
+};
+
+struct Renderable {
+	int *mesh;
+	unsigned char *visible;
+};
+
+/* Per-player gameplay counters that are not shared with any other entity */
+struct Player {
+	int dir;
+	int lives;
+	int coins;
+	int score;
+	int hitno;
+	int speed;
+	bool jump;
+	bool levitate;
+	bool onMTile;
+	bool onMTileJump;
+	bool move1;
+	long jumpStart;	// tick the jump key went in, -1 once it is let go
+	float beforeht;
+	float beforeht1;
+	float lastX, lastY, lastZ;	// where the swept checks of the next tick start
+	long levitateStart;
+	int levitateTimer;
+};
+
+/* Camera and mouse state driven by input. It lives with the simulation
+   because the arrow keys walk relative to the current view. */
+struct Controls {
+	int view;
+	int choice;
+	bool pressNext;	// left button held: steer the look target
+	bool pressMove;	// right button held: scroll walks
+	int moves;
+	float zoom;
+	float base[3];	// preset eye position for choice
+	float eye[3];
+	float target[3];
+};
+
+/* Everything in the world that is not in the arena. No pointers except
+   the timer wheel's, which World::bind() re-points after a copy. */
+struct WorldState {
+	/* Arena sizing: entity slots, grid cells and timer nodes */
+	int capacity;
+	int cellCapacity;
+	int nodeCapacity;
+
+	int count;
+
+	/* Level grid: brick entity per cell, row-major by z */
+	int width;
+	int depth;
+
+	/* Spawn order keeps these contiguous so their systems walk a range:
+	   everything with motion (the obstacles at its tail), the cans and
+	   the coins */
+	int moverBegin, moverEnd;
+	int obstacleBegin, obstacleEnd;
+	int canBegin, canEnd;
+	int coinBegin, coinEnd;
+
+	int player;
+	Player pl;
+	int totalCoins;
+	long tick;
+	int status;
+	TimerWheel timers;
+	Controls ctl;
+	unsigned int seed;
+	Rng levelRng;
+	Rng obstacleRng;
+};
+
+/* Full copy of a world */
+struct Snapshot {
+	WorldState state;
+	std::vector<unsigned char> arena;
+};
+
+/* Arena pages that changed since a full snapshot was taken */
+struct DeltaSnapshot {
+	WorldState state;
+	size_t arenaSize;
+	std::vector<int> pages;
+	std::vector<unsigned char> data;
+};
+
+class World : public WorldState{
+	public:
+		unsigned int *mask;
+		int *kind;
+
+		Transform transform;
+		Motion motion;
+		Collider collider;
+		Pickup pickup;
+		Renderable renderable;
+
+		int *cell;
+		unsigned char *solid;
+		unsigned char *moving;
+
+		World();
+		void clear();
+		/* Size the arena for this many entities, grid cells and timers,
+		   keeping what is already there */
+		void reserve(int capacity, int cells, int nodes);
+		int spawn(int kind, unsigned int mask);
+		/* Schedule on the world's wheel, growing its storage if needed */
+		int schedule(long due, TimerFunc fn, int arg);
+		void generate(int width, int depth, int coins, int obstacles, unsigned int seed, int movingPercent = 5, int cans = 1);
+		unsigned int checksum();
+
+		/* Snapshots. save() also makes the world the base that dirty pages
+		   are counted from; saveDelta() then copies only those pages, and
+		   restoreDelta() and rewind() need the same base snapshot. */
+		void save(Snapshot &snap);
+		void restore(const Snapshot &snap);
+		void saveDelta(DeltaSnapshot &delta);
+		void restoreDelta(const DeltaSnapshot &delta, const Snapshot &base);
+		void rewind(const Snapshot &base);
+		size_t arenaSize(){ return size; }
+		size_t dirtyPages(){ return dirty.list.size(); }
+
+		int cellAt(float x, float z);
+		int brickAt(float x, float z);
+		int cellIndex(int x, int z){ return z*width + x; }
+
+		/* Apply one queued input event */
+		void input(const InputEvent &ev);
+		void changeCam(int choice);
+		int arrowDir(int dir);
+
+		/* Player actions, as triggered by input */
+		void walk(int dir);
+		void startJump();
+		void endJump();
+
+		/* Advance the simulation by one tick */
+		void step();
+
+		/* Systems */
+		void moveBodies();
+		void spinCoins();
+		void collectCoins();
+		float sweepPit(const float from[3], const float to[3]);
+		void checkBelow();
+		void checkBelowMoving();
+		void checkCan();
+		void checkObstacles();
+		void checkBoundary();
+		void checkHealth();
+		void leap();
+		void moveHeld();
+
+		void armReversal(int e);
+		void respawnObstacle(int e);
+		void endLevitation();
+
+		void back();
+		void fall();
+		void settle();
+
+	private:
+		std::vector<unsigned char> arena;
+		unsigned char *mem;	// arena start, cache line aligned
+		size_t size;
+		PageMap dirty;	// arena pages written since the last save()
+
+		World(const World &);
+		World &operator=(const World &);
+		void allocate(size_t size);
+		void bind();
+		void revert(const Snapshot &base);
+		void touch(const void *p, size_t n){ dirty.touch(p, n); }
+};
+
+#endif